@@ -0,0 +1,218 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+// Wake-to-dispatch latency of the evdev capture thread while every core is
+// busy, once at normal scheduling and once with the requested thread options,
+// as JSON on stdout like bench_matcher.
+//
+//   bench_capture_jitter [--quick] [--policy normal|high|realtime]
+//                        [--priority N] [--affinity MASK] [--load THREADS]
+//                        [--events N] [--out results.json]
+//
+// Load threads spin on every CPU. A writer feeds single key events to a FIFO
+// the source reads as a device, a few milliseconds apart so the capture
+// thread is asleep each time, and the sample is the time from just before the
+// write until the sink runs. The writer itself runs at normal priority, so
+// part of the tail is its own delay in getting to the write.
+
+#include "evdev-source.h"
+#include "latency-histogram.h"
+#include "thread-options.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <sys/stat.h>
+
+static int64_t NowNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result {
+	ThreadOptions requested, applied;
+	size_t events, lost;
+	uint64_t p50, p99, max;
+};
+
+static bool WriteKey(int fd, int32_t value)
+{
+	struct input_event ev[2] = {};
+	ev[0].type = EV_KEY;
+	ev[0].code = KEY_A;
+	ev[0].value = value;
+	ev[1].type = EV_SYN;
+	return write(fd, ev, sizeof(ev)) == (ssize_t)sizeof(ev);
+}
+
+static bool Run(const ThreadOptions &options, size_t events, Result &result)
+{
+	char dir[] = "/tmp/capture-jitter-XXXXXX";
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return false;
+	}
+	std::string path = std::string(dir) + "/event0";
+	if (mkfifo(path.c_str(), 0600) != 0) {
+		perror("mkfifo");
+		rmdir(dir);
+		return false;
+	}
+	int fd = open(path.c_str(), O_RDWR);
+
+	std::atomic<int64_t> written{0};
+	std::atomic<bool> received{false};
+	LatencyHistogram latency;
+
+	// Applied by the capture thread to itself, the way the hub does.
+	bool applied = false;
+	result.requested = options;
+	EvdevSource source(dir);
+	source.SetTimerSink([&]() {
+		if (!applied) {
+			result.applied = ApplyThreadOptions(options);
+			applied = true;
+		}
+		return -1;
+	});
+	bool started = fd >= 0 && source.Start([&](const KeyEvent &) {
+		latency.Record((uint64_t)(NowNanos() - written.load(std::memory_order_acquire)));
+		received.store(true, std::memory_order_release);
+	});
+
+	for (int i = 0; started && source.DeviceCount() == 0 && i < 1000; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	result.events = events;
+	result.lost = 0;
+	if (started && source.DeviceCount() == 1) {
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> gap(1000, 3000);
+		for (size_t i = 0; i < events; i++) {
+			std::this_thread::sleep_for(std::chrono::microseconds(gap(rng)));
+			received.store(false, std::memory_order_relaxed);
+			written.store(NowNanos(), std::memory_order_release);
+			WriteKey(fd, i % 2 == 0 ? 1 : 0);
+
+			int64_t deadline = NowNanos() + 1000000000;
+			while (!received.load(std::memory_order_acquire) && NowNanos() < deadline)
+				std::this_thread::yield();
+			result.lost += !received.load(std::memory_order_acquire);
+		}
+	} else {
+		fprintf(stderr, "could not start the evdev source on %s\n", dir);
+		started = false;
+	}
+
+	source.Stop();
+	if (fd >= 0)
+		close(fd);
+	unlink(path.c_str());
+	rmdir(dir);
+
+	result.p50 = latency.Percentile(0.5);
+	result.p99 = latency.Percentile(0.99);
+	result.max = latency.Max();
+	return started;
+}
+
+int main(int argc, char **argv)
+{
+	ThreadOptions options;
+	options.policy = ThreadPolicy::Realtime;
+	size_t load = std::thread::hardware_concurrency();
+	size_t events = 2000;
+	const char *out = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			events = 200;
+		} else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc && ParseThreadPolicy(argv[i + 1], options.policy)) {
+			i++;
+		} else if (strcmp(argv[i], "--priority") == 0 && i + 1 < argc) {
+			options.priority = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--affinity") == 0 && i + 1 < argc) {
+			options.affinity = strtoull(argv[++i], nullptr, 0);
+		} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			load = (size_t)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+			events = (size_t)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			out = argv[++i];
+		} else {
+			fprintf(stderr,
+				"usage: %s [--quick] [--policy normal|high|realtime] [--priority N] [--affinity MASK] "
+				"[--load THREADS] [--events N] [--out results.json]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> spinners;
+	for (size_t i = 0; i < load; i++) {
+		spinners.emplace_back([&stop]() {
+			volatile uint64_t spins = 0;
+			while (!stop.load(std::memory_order_relaxed))
+				spins = spins + 1;
+		});
+	}
+
+	std::vector<Result> results(2);
+	bool ok = Run(ThreadOptions(), events, results[0]) && Run(options, events, results[1]);
+
+	stop = true;
+	for (std::thread &spinner : spinners)
+		spinner.join();
+	if (!ok)
+		return 1;
+
+	std::string json = "{\n  \"benchmark\": \"capture_jitter\",\n  \"schema\": 1,\n  \"load\": " + std::to_string(load) + ",\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		char line[512];
+		snprintf(line, sizeof(line),
+			 "    {\"requested\": \"%s\", \"policy\": \"%s\", \"priority\": %d, \"affinity\": %llu, \"events\": %zu, "
+			 "\"lost\": %zu, \"latencyNs\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}}%s\n",
+			 ThreadPolicyName(r.requested.policy), ThreadPolicyName(r.applied.policy), r.applied.priority,
+			 (unsigned long long)r.applied.affinity, r.events, r.lost, (unsigned long long)r.p50, (unsigned long long)r.p99,
+			 (unsigned long long)r.max, i + 1 < results.size() ? "," : "");
+		json += line;
+	}
+	json += "  ]\n}\n";
+
+	fputs(json.c_str(), stdout);
+	if (out) {
+		FILE *file = fopen(out, "w");
+		if (!file) {
+			perror(out);
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+	return 0;
+}
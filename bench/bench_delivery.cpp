@@ -0,0 +1,102 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+// Hook-to-JS latency of the two delivery paths, driven by bench_delivery.js.
+// A native thread plays the hook: it stamps each fire and either queues an
+// AsyncWorker with an empty Execute (the old Windows path, one libuv threadpool
+// hop) or calls a ThreadSafeFunction (the current path, straight to the JS
+// thread). The JS side receives the measured microseconds per fire.
+
+#include <napi.h>
+
+#include <chrono>
+#include <thread>
+
+static int64_t NowMicros()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class EmptyWorker : public Napi::AsyncWorker {
+public:
+	EmptyWorker(Napi::Function &callback, int64_t fired) : AsyncWorker(callback), m_fired(fired){};
+
+	void Execute(){};
+	void OnOK() { Callback().Call({Napi::Number::New(Env(), (double)(NowMicros() - m_fired))}); };
+
+private:
+	int64_t m_fired;
+};
+
+struct Run {
+	Napi::ThreadSafeFunction tsfn;
+	std::thread thread;
+	bool worker;
+	uint32_t count;
+	uint32_t intervalUs;
+};
+
+// The old code queued its workers straight from the hook thread, which
+// libuv does not allow. Here the worker is queued from the JS thread instead
+// and stamped at that point, so only the threadpool hop itself is measured.
+static void OnFire(Napi::Env env, Napi::Function callback, Run *run, int64_t *fired)
+{
+	int64_t stamp = *fired;
+	delete fired;
+
+	if (run->worker)
+		(new EmptyWorker(callback, NowMicros()))->Queue();
+	else
+		callback.Call({Napi::Number::New(env, (double)(NowMicros() - stamp))});
+}
+
+// run(mode, count, intervalUs, callback): mode is 'tsfn' or 'worker', the
+// callback gets one latency sample in microseconds per fire.
+static Napi::Value RunJS(const Napi::CallbackInfo &info)
+{
+	Napi::Env env = info.Env();
+	Run *run = new Run;
+	run->worker = info[0].ToString().Utf8Value() == "worker";
+	run->count = info[1].ToNumber().Uint32Value();
+	run->intervalUs = info[2].ToNumber().Uint32Value();
+
+	run->tsfn = Napi::ThreadSafeFunction::New(
+		env, info[3].As<Napi::Function>(), "bench_delivery", 0, 1,
+		[](Napi::Env, Run *run) {
+			run->thread.join();
+			delete run;
+		},
+		run);
+
+	run->thread = std::thread([run]() {
+		for (uint32_t i = 0; i < run->count; i++) {
+			std::this_thread::sleep_for(std::chrono::microseconds(run->intervalUs));
+			run->tsfn.NonBlockingCall(new int64_t(NowMicros()), [run](Napi::Env env, Napi::Function callback, int64_t *fired) { OnFire(env, callback, run, fired); });
+		}
+		run->tsfn.Release();
+	});
+	return env.Undefined();
+}
+
+static Napi::Object Init(Napi::Env env, Napi::Object exports)
+{
+	exports.Set("run", Napi::Function::New(env, RunJS));
+	return exports;
+}
+
+NODE_API_MODULE(bench_delivery, Init)
@@ -0,0 +1,48 @@
+// Compares hook-to-JS latency of ThreadSafeFunction delivery with the old
+// AsyncWorker-per-fire path, idle and with the libuv threadpool saturated.
+//
+//   node bench/bench_delivery.js [path/to/bench_delivery.node]
+
+const crypto = require('crypto');
+const path = require('path');
+
+const addon = require(process.argv[2] || path.join(__dirname, '..', 'build', 'bench_delivery.node'));
+
+const FIRES = 2000;
+const INTERVAL_US = 500;
+const POOL_SIZE = parseInt(process.env.UV_THREADPOOL_SIZE || '4', 10);
+
+function measure(mode) {
+  return new Promise((resolve) => {
+    const samples = [];
+    addon.run(mode, FIRES, INTERVAL_US, (us) => {
+      samples.push(us);
+      if (samples.length === FIRES) resolve(samples);
+    });
+  });
+}
+
+function report(label, samples) {
+  samples.sort((a, b) => a - b);
+  const at = (p) => samples[Math.min(samples.length - 1, Math.floor(samples.length * p))];
+  console.log(`${label.padEnd(18)} p50 ${String(at(0.5)).padStart(7)} us   p99 ${String(at(0.99)).padStart(7)} us   max ${String(samples[samples.length - 1]).padStart(7)} us`);
+}
+
+// Keeps every threadpool thread busy with key derivations until stopped.
+function loadThreadpool() {
+  let running = true;
+  const spin = () => {
+    if (running) crypto.pbkdf2('secret', 'salt', 20000, 64, 'sha512', spin);
+  };
+  for (let i = 0; i < POOL_SIZE; i++) spin();
+  return () => { running = false; };
+}
+
+(async () => {
+  for (const loaded of [false, true]) {
+    const stop = loaded ? loadThreadpool() : () => {};
+    for (const mode of ['tsfn', 'worker'])
+      report(`${mode}${loaded ? ' +pool load' : ''}`, await measure(mode));
+    stop();
+  }
+})();
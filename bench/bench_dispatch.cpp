@@ -0,0 +1,109 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+// Per-keystroke matching cost as the number of bindings grows. The indexed
+// engine should stay flat while the linear scan it replaced grows with N.
+
+#include "hotkey-engine.h"
+
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_ALT, KEY_META, KEY_FIRST };
+
+typedef std::vector<std::pair<keycode_t, bool>> Keys;
+
+static Keys MakeKeys(keycode_t key, unsigned mods)
+{
+	return {{KEY_SHIFT, (mods & 1) != 0}, {KEY_CTRL, (mods & 2) != 0}, {KEY_ALT, (mods & 4) != 0}, {KEY_META, (mods & 8) != 0}, {key, true}};
+}
+
+// The pre-index matcher: every event walks every binding.
+struct LinearMatcher {
+	std::vector<Keys> bindings;
+	std::bitset<0x10000> pressed;
+	size_t matches = 0;
+
+	void OnKeyEvent(const KeyEvent &event)
+	{
+		pressed.set(event.key, event.down);
+		for (const Keys &keys : bindings) {
+			if (keys.back().first != event.key)
+				continue;
+			bool all = true;
+			for (const std::pair<keycode_t, bool> &k : keys)
+				all = all && (pressed.test(k.first) == k.second);
+			matches += all;
+		}
+	}
+};
+
+template<class Matcher> static double NanosPerEvent(Matcher &matcher, const std::vector<KeyEvent> &events)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int round = 0; round < 10; round++) {
+		for (const KeyEvent &event : events)
+			matcher.OnKeyEvent(event);
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / (events.size() * 10);
+}
+
+int main()
+{
+	std::mt19937 rng(42);
+	std::cout << "bindings   indexed ns/event   linear ns/event" << std::endl;
+
+	for (size_t count : {10, 100, 1000, 10000}) {
+		size_t fired = 0;
+		KeyState state({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}, {KEY_ALT, MOD_ALT, false}, {KEY_META, MOD_META, false}});
+		HotkeyEngine engine([&fired](ChordId, KeyEdge) { fired++; }, state);
+		LinearMatcher linear;
+
+		// Roughly sixteen modifier variants per key, like per-scene bindings.
+		std::vector<keycode_t> keys;
+		for (size_t i = 0; i < count; i++) {
+			keycode_t key = (keycode_t)(KEY_FIRST + i / 16);
+			engine.SetHotkey((uint32_t)i, {key, (uint8_t)(i % 16), MOD_ALL});
+			linear.bindings.push_back(MakeKeys(key, (unsigned)(i % 16)));
+			keys.push_back(key);
+		}
+
+		std::vector<KeyEvent> events;
+		std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+		for (int i = 0; i < 20000; i++) {
+			keycode_t mod = (keycode_t)(KEY_SHIFT + i % 4);
+			keycode_t key = keys[pick(rng)];
+			bool withMod = i % 3 == 0;
+			if (withMod)
+				events.push_back({mod, true});
+			events.push_back({key, true});
+			events.push_back({key, false});
+			if (withMod)
+				events.push_back({mod, false});
+		}
+
+		double indexed = NanosPerEvent(engine, events);
+		double scanned = NanosPerEvent(linear, events);
+		printf("%8zu   %16.1f   %15.1f\n", count, indexed, scanned);
+	}
+	return 0;
+}
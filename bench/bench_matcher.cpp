@@ -0,0 +1,170 @@
+// Matcher throughput and per-event latency across binding counts and input
+// mixes, as JSON on stdout so runs of different versions can be diffed.
+//
+//   bench_matcher [--quick] [--out results.json]
+//
+// Each workload is replayed once to warm up, then timed as a whole for
+// events/sec and event by event for the latency percentiles. Timing single
+// events adds the cost of two clock reads to each sample.
+
+#include "hotkey-engine.h"
+#include "latency-histogram.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_ALT, KEY_META, KEY_FIRST };
+
+static const keycode_t Modifiers[] = {KEY_SHIFT, KEY_CTRL, KEY_ALT, KEY_META};
+
+struct Workload {
+	const char *name;
+	std::vector<KeyEvent> events;
+};
+
+// Taps of bound keys. Every heldMods-th tap is made with that many modifiers
+// held, the rest without.
+static Workload Taps(const char *name, const std::vector<keycode_t> &keys, size_t taps, int heldMods, std::mt19937 &rng)
+{
+	Workload workload = {name, {}};
+	std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+	for (size_t i = 0; i < taps; i++) {
+		int mods = heldMods > 0 && i % 3 == 0 ? heldMods : 0;
+		for (int m = 0; m < mods; m++)
+			workload.events.push_back({Modifiers[(i + m) % 4], true});
+		keycode_t key = keys[pick(rng)];
+		workload.events.push_back({key, true});
+		workload.events.push_back({key, false});
+		for (int m = mods - 1; m >= 0; m--)
+			workload.events.push_back({Modifiers[(i + m) % 4], false});
+	}
+	return workload;
+}
+
+// Keys held down long enough to auto-repeat, some with a modifier.
+static Workload RepeatStorm(const std::vector<keycode_t> &keys, size_t holds, std::mt19937 &rng)
+{
+	Workload workload = {"repeat_storm", {}};
+	std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+	for (size_t i = 0; i < holds; i++) {
+		bool withCtrl = i % 2 == 0;
+		keycode_t key = keys[pick(rng)];
+		if (withCtrl)
+			workload.events.push_back({KEY_CTRL, true});
+		for (int repeat = 0; repeat < 30; repeat++)
+			workload.events.push_back({key, true});
+		workload.events.push_back({key, false});
+		if (withCtrl)
+			workload.events.push_back({KEY_CTRL, false});
+	}
+	return workload;
+}
+
+struct Result {
+	size_t bindings;
+	const char *workload;
+	size_t events;
+	size_t fired;
+	double eventsPerSec;
+	uint64_t p50, p99, max;
+};
+
+static Result Run(size_t bindings, const Workload &workload)
+{
+	size_t fired = 0;
+	HotkeyEngine engine([&fired](ChordId, KeyEdge) { fired++; },
+			    KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}, {KEY_ALT, MOD_ALT, false}, {KEY_META, MOD_META, false}}));
+
+	// Sixteen modifier variants per key, like per-scene bindings, built into
+	// one table the way registerCallbacks does.
+	std::unique_ptr<HotkeyTable> table(new HotkeyTable());
+	for (size_t i = 0; i < bindings; i++) {
+		Chord chord = {(keycode_t)(KEY_FIRST + i / 16), (uint8_t)(i % 16), MOD_ALL};
+		engine.SetHotkey(*table, MakeChordId(chord), chord);
+	}
+	engine.Publish(std::move(table));
+
+	for (const KeyEvent &event : workload.events)
+		engine.OnKeyEvent(event);
+	fired = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const KeyEvent &event : workload.events)
+		engine.OnKeyEvent(event);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	size_t firedOnce = fired;
+
+	LatencyHistogram latency;
+	for (const KeyEvent &event : workload.events) {
+		auto before = std::chrono::steady_clock::now();
+		engine.OnKeyEvent(event);
+		latency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+	}
+
+	return {bindings,
+		workload.name,
+		workload.events.size(),
+		firedOnce,
+		workload.events.size() / elapsed.count(),
+		latency.Percentile(0.5),
+		latency.Percentile(0.99),
+		latency.Max()};
+}
+
+int main(int argc, char **argv)
+{
+	bool quick = false;
+	const char *out = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0) {
+			quick = true;
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			out = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--quick] [--out results.json]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<Result> results;
+	size_t taps = quick ? 2000 : 50000;
+	for (size_t bindings : {10, 100, 1000, 10000}) {
+		// The same seed for every count, so only the bindings differ.
+		std::mt19937 rng(42);
+		std::vector<keycode_t> keys;
+		for (size_t i = 0; i < bindings; i += 16)
+			keys.push_back((keycode_t)(KEY_FIRST + i / 16));
+
+		for (const Workload &workload : {Taps("no_modifiers", keys, taps, 0, rng), Taps("one_modifier", keys, taps, 1, rng),
+						 Taps("three_modifiers", keys, taps, 3, rng), RepeatStorm(keys, taps / 10, rng)})
+			results.push_back(Run(bindings, workload));
+	}
+
+	std::string json = "{\n  \"benchmark\": \"matcher\",\n  \"schema\": 1,\n  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		char line[512];
+		snprintf(line, sizeof(line),
+			 "    {\"bindings\": %zu, \"workload\": \"%s\", \"events\": %zu, \"fired\": %zu, \"eventsPerSec\": %.0f, "
+			 "\"latencyNs\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}}%s\n",
+			 r.bindings, r.workload, r.events, r.fired, r.eventsPerSec, (unsigned long long)r.p50, (unsigned long long)r.p99,
+			 (unsigned long long)r.max, i + 1 < results.size() ? "," : "");
+		json += line;
+	}
+	json += "  ]\n}\n";
+
+	fputs(json.c_str(), stdout);
+	if (out) {
+		FILE *file = fopen(out, "w");
+		if (!file) {
+			perror(out);
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,75 @@
+// Records raw input from /dev/input into a binary trace until interrupted,
+// headless, for trace_replay.
+//
+//   trace_record session.trace [--dir /dev/input]
+//
+// Needs read access to the event nodes, usually membership of the "input"
+// group.
+
+#include "evdev-source.h"
+#include "input-trace.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal(int)
+{
+	g_stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = nullptr;
+	std::string directory = "/dev/input";
+	bool usage = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+			directory = argv[++i];
+		else if (!path && argv[i][0] != '-')
+			path = argv[i];
+		else
+			usage = true;
+	}
+	if (!path || usage) {
+		fprintf(stderr, "usage: %s <out.trace> [--dir /dev/input]\n", argv[0]);
+		return 2;
+	}
+
+	TraceWriter writer;
+	if (!writer.Open(path)) {
+		perror(path);
+		return 1;
+	}
+
+	// The writer is only touched by the reader thread until Stop joins it.
+	EvdevSource source(directory);
+	source.SetInputSink([&writer](const InputEvent &event) {
+		uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		writer.Append(now, event);
+	});
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+	if (!source.Start([](const KeyEvent &) {})) {
+		fprintf(stderr, "Unable to watch %s, is the user in the input group?\n", directory.c_str());
+		return 1;
+	}
+	fprintf(stderr, "Recording %zu devices into %s, Ctrl+C to stop.\n", source.DeviceCount(), path);
+
+	while (!g_stop)
+		pause();
+
+	source.Stop();
+	uint64_t count = writer.Count();
+	if (!writer.Close()) {
+		perror(path);
+		return 1;
+	}
+	fprintf(stderr, "%llu events recorded.\n", (unsigned long long)count);
+	return 0;
+}
@@ -0,0 +1,245 @@
+// Replays a trace from trace_record through the hotkey engine, the way the
+// Linux backend feeds it, and reports what fired and how long matching took
+// as JSON, so two builds can be diffed on the same session.
+//
+//   trace_replay session.trace [--realtime] [--repeat N] [--bindings FILE] [--out FILE]
+//
+// By default every chord pressed in the trace is bound. A bindings file has
+// one chord per line, a key name followed by any of shift, ctrl, alt, meta;
+// # starts a comment. --realtime sleeps to reproduce the original timing and
+// also reports how late each event was replayed.
+
+#include "evdev-source.h"
+#include "input-trace.h"
+#include "key-names.h"
+#include "latency-histogram.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+
+struct Options {
+	const char *trace = nullptr;
+	const char *bindings = nullptr;
+	const char *out = nullptr;
+	bool realtime = false;
+	int repeat = 1;
+};
+
+struct Fires {
+	uint64_t pressed = 0, released = 0;
+};
+
+static uint64_t NowNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What the engine saw of a record, mouse buttons included: evdev reports them
+// as keys.
+static bool ToKeyEvent(const InputEvent &event, KeyEvent &key)
+{
+	switch (event.type) {
+	case InputType::KeyDown:
+	case InputType::KeyUp:
+		key = {event.code, event.type == InputType::KeyDown};
+		return true;
+	case InputType::MousePressed:
+	case InputType::MouseReleased:
+		key = {(keycode_t)(BTN_LEFT + event.code - 1), event.type == InputType::MousePressed};
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool LoadBindings(const char *path, std::vector<Chord> &chords)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	for (int number = 1; std::getline(file, line); number++) {
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string word;
+		if (!(words >> word))
+			continue;
+
+		Chord chord = {0, 0, MOD_ALL};
+		if (!g_KeyNames.Find(word, chord.key)) {
+			fprintf(stderr, "%s:%d: unknown key %s\n", path, number, word.c_str());
+			return false;
+		}
+		while (words >> word) {
+			if (word == "shift")
+				chord.modifiers |= MOD_SHIFT;
+			else if (word == "ctrl")
+				chord.modifiers |= MOD_CTRL;
+			else if (word == "alt")
+				chord.modifiers |= MOD_ALT;
+			else if (word == "meta")
+				chord.modifiers |= MOD_META;
+			else {
+				fprintf(stderr, "%s:%d: unknown modifier %s\n", path, number, word.c_str());
+				return false;
+			}
+		}
+		chords.push_back(chord);
+	}
+	return true;
+}
+
+// Every non-modifier key press with the modifiers held at the time.
+static std::vector<Chord> ChordsInTrace(const std::vector<TraceRecord> &records)
+{
+	KeyState state = EvdevKeyState();
+	std::map<ChordId, Chord> chords;
+	for (const TraceRecord &record : records) {
+		KeyEvent key, edges[2];
+		if (!ToKeyEvent(record.event, key))
+			continue;
+		size_t count = state.Update(key, edges);
+		for (size_t i = 0; i < count; i++) {
+			if (edges[i].down && !state.ModifierOf(edges[i].key))
+				chords[MakeChordId(edges[i].key, state.Modifiers())] = {edges[i].key, state.Modifiers(), MOD_ALL};
+		}
+	}
+
+	std::vector<Chord> list;
+	for (const auto &entry : chords)
+		list.push_back(entry.second);
+	return list;
+}
+
+static std::string Summary(const LatencyHistogram &histogram)
+{
+	char text[128];
+	snprintf(text, sizeof(text), "{\"p50\": %llu, \"p99\": %llu, \"max\": %llu}", (unsigned long long)histogram.Percentile(0.5),
+		 (unsigned long long)histogram.Percentile(0.99), (unsigned long long)histogram.Max());
+	return text;
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	bool usage = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--realtime") == 0)
+			options.realtime = true;
+		else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			options.repeat = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bindings") == 0 && i + 1 < argc)
+			options.bindings = argv[++i];
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			options.out = argv[++i];
+		else if (!options.trace && argv[i][0] != '-')
+			options.trace = argv[i];
+		else
+			usage = true;
+	}
+	if (!options.trace || usage || options.repeat < 1) {
+		fprintf(stderr, "usage: %s <trace> [--realtime] [--repeat N] [--bindings FILE] [--out FILE]\n", argv[0]);
+		return 2;
+	}
+
+	TraceReader reader;
+	if (!reader.Open(options.trace)) {
+		fprintf(stderr, "%s: %s\n", options.trace, reader.Error().c_str());
+		return 1;
+	}
+	if (reader.Platform() != TracePlatform::Linux) {
+		fprintf(stderr, "%s: recorded on another platform, its key codes don't apply\n", options.trace);
+		return 1;
+	}
+	const std::vector<TraceRecord> &records = reader.Records();
+
+	std::vector<Chord> chords;
+	if (!options.bindings) {
+		chords = ChordsInTrace(records);
+	} else if (!LoadBindings(options.bindings, chords)) {
+		fprintf(stderr, "%s: can't load bindings\n", options.bindings);
+		return 1;
+	}
+
+	std::map<ChordId, Fires> fires;
+	HotkeyEngine engine(
+		[&fires](ChordId id, KeyEdge edge) {
+			Fires &f = fires[id];
+			(edge == KeyEdge::Pressed ? f.pressed : f.released)++;
+		},
+		EvdevKeyState());
+	std::unique_ptr<HotkeyTable> table(new HotkeyTable());
+	for (const Chord &chord : chords)
+		engine.SetHotkey(*table, MakeChordId(chord), chord);
+	engine.Publish(std::move(table));
+
+	LatencyHistogram latency, lag;
+	uint64_t keyEvents = 0, elapsed = 0;
+	for (int round = 0; round < options.repeat; round++) {
+		uint64_t start = NowNs();
+		for (const TraceRecord &record : records) {
+			KeyEvent key;
+			if (!ToKeyEvent(record.event, key))
+				continue;
+
+			if (options.realtime) {
+				uint64_t due = start + record.timeNs;
+				uint64_t now = NowNs();
+				if (now < due) {
+					std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+					now = NowNs();
+				}
+				lag.Record(now - due);
+			}
+
+			uint64_t before = NowNs();
+			engine.OnKeyEvent(key);
+			uint64_t after = NowNs();
+			latency.Record(after - before);
+			elapsed += after - before;
+			keyEvents++;
+		}
+	}
+
+	uint64_t pressed = 0, released = 0;
+	std::string perBinding;
+	for (const auto &entry : fires) {
+		char line[128];
+		snprintf(line, sizeof(line), "%s\n    {\"id\": %llu, \"pressed\": %llu, \"released\": %llu}", perBinding.empty() ? "" : ",",
+			 (unsigned long long)entry.first, (unsigned long long)entry.second.pressed, (unsigned long long)entry.second.released);
+		perBinding += line;
+		pressed += entry.second.pressed;
+		released += entry.second.released;
+	}
+
+	char head[1024];
+	snprintf(head, sizeof(head),
+		 "{\n  \"trace\": \"%s\",\n  \"mode\": \"%s\",\n  \"repeat\": %d,\n  \"records\": %zu,\n  \"durationNs\": %llu,\n  \"bindings\": %zu,\n"
+		 "  \"keyEvents\": %llu,\n  \"matchNs\": %llu,\n  \"keyEventsPerSec\": %.0f,\n  \"latencyNs\": %s,\n",
+		 options.trace, options.realtime ? "realtime" : "fast", options.repeat, records.size(),
+		 (unsigned long long)(records.empty() ? 0 : records.back().timeNs), chords.size(), (unsigned long long)keyEvents,
+		 (unsigned long long)elapsed, elapsed ? keyEvents * 1e9 / elapsed : 0.0, Summary(latency).c_str());
+	std::string json = head;
+	if (options.realtime)
+		json += "  \"lagNs\": " + Summary(lag) + ",\n";
+	json += "  \"fired\": {\"pressed\": " + std::to_string(pressed) + ", \"released\": " + std::to_string(released) + "},\n";
+	json += "  \"fires\": [" + perBinding + (perBinding.empty() ? "]\n}\n" : "\n  ]\n}\n");
+
+	fputs(json.c_str(), stdout);
+	if (options.out) {
+		FILE *file = fopen(options.out, "w");
+		if (!file) {
+			perror(options.out);
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+	return 0;
+}
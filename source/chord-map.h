@@ -0,0 +1,135 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Identity of a binding: see MakeChordId in hotkey-table.h.
+typedef uint64_t ChordId;
+
+// Open addressing hash table keyed by ChordId. Keys and values live in two
+// flat arrays probed linearly, so a lookup touches one or two cache lines and
+// nothing is allocated except when the table grows. Erasing shifts the
+// following entries back instead of leaving tombstones.
+//
+// ~0 is reserved as the empty marker and can't be used as a key.
+template<class V> class ChordMap {
+public:
+	static constexpr ChordId Empty = ~(ChordId)0;
+
+	ChordMap() { Rehash(16); };
+
+	size_t Size() const { return m_size; };
+
+	V *Find(ChordId key)
+	{
+		for (size_t i = Home(key);; i = (i + 1) & m_mask) {
+			if (m_keys[i] == key)
+				return &m_values[i];
+			if (m_keys[i] == Empty)
+				return nullptr;
+		}
+	};
+
+	const V *Find(ChordId key) const { return const_cast<ChordMap *>(this)->Find(key); };
+
+	// Returns the value for key, default constructing it if missing.
+	V &operator[](ChordId key)
+	{
+		if ((m_size + 1) * 2 > m_keys.size())
+			Rehash(m_keys.size() * 2);
+
+		size_t i = Home(key);
+		for (; m_keys[i] != Empty; i = (i + 1) & m_mask) {
+			if (m_keys[i] == key)
+				return m_values[i];
+		}
+		m_keys[i] = key;
+		m_size++;
+		return m_values[i];
+	};
+
+	bool Erase(ChordId key)
+	{
+		size_t i = Home(key);
+		for (; m_keys[i] != key; i = (i + 1) & m_mask) {
+			if (m_keys[i] == Empty)
+				return false;
+		}
+
+		// Pull back every following entry of the run that may sit at or
+		// before the hole, so probes never stop early.
+		for (size_t j = (i + 1) & m_mask; m_keys[j] != Empty; j = (j + 1) & m_mask) {
+			if (((j - Home(m_keys[j])) & m_mask) >= ((j - i) & m_mask)) {
+				m_keys[i] = m_keys[j];
+				m_values[i] = std::move(m_values[j]);
+				i = j;
+			}
+		}
+		m_keys[i] = Empty;
+		m_values[i] = V();
+		m_size--;
+		return true;
+	};
+
+	void Clear()
+	{
+		m_keys.clear();
+		m_values.clear();
+		Rehash(16);
+	};
+
+	template<class F> void ForEach(F f)
+	{
+		for (size_t i = 0; i < m_keys.size(); i++) {
+			if (m_keys[i] != Empty)
+				f(m_keys[i], m_values[i]);
+		}
+	};
+
+private:
+	size_t Home(ChordId key) const { return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> m_shift); };
+
+	void Rehash(size_t capacity)
+	{
+		std::vector<ChordId> keys(capacity, Empty);
+		std::vector<V> values(capacity);
+		std::swap(keys, m_keys);
+		std::swap(values, m_values);
+
+		m_mask = capacity - 1;
+		m_shift = 64;
+		for (size_t c = capacity; c > 1; c >>= 1)
+			m_shift--;
+		m_size = 0;
+
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] != Empty)
+				(*this)[keys[i]] = std::move(values[i]);
+		}
+	};
+
+	std::vector<ChordId> m_keys;
+	std::vector<V> m_values;
+	size_t m_mask = 0;
+	unsigned m_shift = 64;
+	size_t m_size = 0;
+};
@@ -0,0 +1,49 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+// Lets a thread that swapped out what the dispatching thread reads wait until
+// that thread is done with the old version. A single counter is odd while a
+// dispatch runs, so the waiter can't see a dispatch start or end half way.
+//
+// The dispatching thread brackets each dispatch with Begin and End. Dispatches
+// must not overlap.
+class DispatchSequence {
+public:
+	// Dispatching thread only. Begin before loading what was published.
+	void Begin() { m_sequence.fetch_add(1, std::memory_order_seq_cst); };
+	void End() { m_sequence.fetch_add(1, std::memory_order_release); };
+
+	// Any other thread, after publishing. Returns once a dispatch that may
+	// have loaded the old version is over; never waits for the next one.
+	void Wait() const
+	{
+		uint64_t sequence = m_sequence.load(std::memory_order_seq_cst);
+		if (sequence & 1) {
+			while (m_sequence.load(std::memory_order_acquire) == sequence)
+				std::this_thread::yield();
+		}
+	};
+
+private:
+	std::atomic<uint64_t> m_sequence{0};
+};
@@ -0,0 +1,80 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+// Maps a 16 bit key code to the bindings that can react to it. Codes are split
+// into a page (high byte) and a slot (low byte) so only pages with bindings
+// cost memory; a lookup is two indexed loads and never depends on how many
+// bindings other keys have.
+template<class T> class KeyDispatchTable {
+public:
+	typedef std::vector<T> Slot;
+
+	KeyDispatchTable() = default;
+	KeyDispatchTable(const KeyDispatchTable &other) { *this = other; };
+	KeyDispatchTable &operator=(const KeyDispatchTable &other)
+	{
+		for (size_t i = 0; i < m_pages.size(); i++)
+			m_pages[i].reset(other.m_pages[i] ? new PageT(*other.m_pages[i]) : nullptr);
+		return *this;
+	};
+
+	void Add(uint16_t key, const T &value) { Page(key, true)->at(key & 0xFF).push_back(value); };
+
+	void Remove(uint16_t key, const T &value)
+	{
+		PageT *page = Page(key, false);
+		if (!page)
+			return;
+
+		Slot &slot = page->at(key & 0xFF);
+		slot.erase(std::remove(slot.begin(), slot.end(), value), slot.end());
+	};
+
+	const Slot &Candidates(uint16_t key) const
+	{
+		static const Slot empty;
+		const std::unique_ptr<PageT> &page = m_pages[key >> 8];
+		return page ? (*page)[key & 0xFF] : empty;
+	};
+
+	void Clear()
+	{
+		for (std::unique_ptr<PageT> &page : m_pages)
+			page.reset();
+	};
+
+private:
+	typedef std::array<Slot, 256> PageT;
+
+	PageT *Page(uint16_t key, bool create)
+	{
+		std::unique_ptr<PageT> &page = m_pages[key >> 8];
+		if (!page && create)
+			page.reset(new PageT());
+		return page.get();
+	};
+
+	std::array<std::unique_ptr<PageT>, 256> m_pages;
+};
@@ -0,0 +1,375 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "evdev-source.h"
+#include "key-names.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+
+KeyState EvdevKeyState()
+{
+	return KeyState({
+		{KEY_GENERIC_SHIFT, MOD_SHIFT, true},
+		{KEY_LEFTSHIFT, MOD_SHIFT, false},
+		{KEY_RIGHTSHIFT, MOD_SHIFT, false},
+		{KEY_GENERIC_CONTROL, MOD_CTRL, true},
+		{KEY_LEFTCTRL, MOD_CTRL, false},
+		{KEY_RIGHTCTRL, MOD_CTRL, false},
+		{KEY_GENERIC_ALT, MOD_ALT, true},
+		{KEY_LEFTALT, MOD_ALT, false},
+		{KEY_RIGHTALT, MOD_ALT, false},
+		{KEY_GENERIC_META, MOD_META, true},
+		{KEY_LEFTMETA, MOD_META, false},
+		{KEY_RIGHTMETA, MOD_META, false},
+	});
+}
+
+static bool IsEventNode(const char *name)
+{
+	return strncmp(name, "event", 5) == 0;
+}
+
+EvdevSource::~EvdevSource()
+{
+	Stop();
+	if (m_inotify >= 0)
+		close(m_inotify);
+}
+
+bool EvdevSource::Start(Sink sink)
+{
+	if (m_thread.joinable())
+		return false;
+
+	m_sink = std::move(sink);
+	m_stopping = false;
+
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	m_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (m_inotify < 0)
+		m_inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (m_epoll < 0 || m_wake < 0 || m_inotify < 0) {
+		Stop();
+		return false;
+	}
+
+	// Whatever the last run's watch left behind.
+	char stale[4096];
+	while (read(m_inotify, stale, sizeof(stale)) > 0) {
+	}
+
+	// IN_ATTRIB catches nodes that udev creates before granting access.
+	m_watch = inotify_add_watch(m_inotify, m_directory.c_str(), IN_CREATE | IN_ATTRIB | IN_DELETE);
+	if (m_watch < 0) {
+		Stop();
+		return false;
+	}
+
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = m_wake;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+	ev.data.fd = m_inotify;
+	epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_inotify, &ev);
+
+	DIR *dir = opendir(m_directory.c_str());
+	if (dir) {
+		while (struct dirent *entry = readdir(dir)) {
+			if (IsEventNode(entry->d_name))
+				OpenDevice(entry->d_name);
+		}
+		closedir(dir);
+	}
+
+	m_thread = std::thread(&EvdevSource::Run, this);
+	return true;
+}
+
+void EvdevSource::Stop()
+{
+	if (m_thread.joinable()) {
+		m_stopping = true;
+		Wake();
+		m_thread.join();
+	}
+
+	for (auto &device : m_devices)
+		close(device.first);
+	m_devices.clear();
+	m_deviceCount = 0;
+
+	// Closing an inotify instance waits for an RCU grace period, often over
+	// 10 ms, so it lives as long as the source and only the watch goes.
+	if (m_watch >= 0)
+		inotify_rm_watch(m_inotify, m_watch);
+	m_watch = -1;
+
+	for (int *fd : {&m_epoll, &m_wake}) {
+		if (*fd >= 0)
+			close(*fd);
+		*fd = -1;
+	}
+}
+
+void EvdevSource::Wake()
+{
+	uint64_t one = 1;
+	if (m_wake >= 0 && write(m_wake, &one, sizeof(one)) != sizeof(one)) {
+	}
+}
+
+void EvdevSource::Run()
+{
+	struct epoll_event events[16];
+
+	while (true) {
+		int count = epoll_wait(m_epoll, events, 16, m_timerSink ? m_timerSink() : -1);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		for (int i = 0; i < count; i++) {
+			int fd = events[i].data.fd;
+			if (fd == m_wake) {
+				uint64_t wakes;
+				if (read(m_wake, &wakes, sizeof(wakes)) != sizeof(wakes)) {
+				}
+				if (m_stopping)
+					return;
+				continue;
+			}
+
+			if (fd == m_inotify) {
+				ReadNotifications();
+				continue;
+			}
+
+			// Closed earlier in this batch, and the number may have been
+			// reused since.
+			if (m_devices.find(fd) == m_devices.end())
+				continue;
+			if (events[i].events & EPOLLIN)
+				ReadDevice(fd);
+			else if (events[i].events & (EPOLLERR | EPOLLHUP))
+				CloseDevice(fd);
+		}
+	}
+}
+
+void EvdevSource::OpenDevice(const std::string &name)
+{
+	for (auto &device : m_devices) {
+		if (device.second.name == name)
+			return;
+	}
+
+	std::string path = m_directory + "/" + name;
+	int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	// Skip devices that cannot produce key events (accelerometers, lid
+	// switches, ...). Nodes that are not evdev devices at all fail the ioctl
+	// and are kept, they are fakes fed by tests.
+	unsigned long types = 0;
+	if (ioctl(fd, EVIOCGBIT(0, sizeof(types)), &types) >= 0 && !(types & (1UL << EV_KEY))) {
+		close(fd);
+		return;
+	}
+
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close(fd);
+		return;
+	}
+
+	m_devices[fd].name = name;
+	m_deviceCount = m_devices.size();
+}
+
+void EvdevSource::CloseDevice(int fd)
+{
+	auto device = m_devices.find(fd);
+	if (device == m_devices.end())
+		return;
+
+	// An unplugged device never sends the releases of its held keys.
+	Resync(-1, device->second);
+
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, NULL);
+	close(fd);
+	m_devices.erase(device);
+	m_deviceCount = m_devices.size();
+}
+
+void EvdevSource::ReadDevice(int fd)
+{
+	struct input_event buffer[64];
+
+	while (true) {
+		ssize_t bytes = read(fd, buffer, sizeof(buffer));
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			// ENODEV once the device is unplugged.
+			if (errno != EAGAIN)
+				CloseDevice(fd);
+			return;
+		}
+		if (bytes == 0) {
+			CloseDevice(fd);
+			return;
+		}
+
+		// Nothing in the loop opens or closes devices.
+		Device &device = m_devices[fd];
+		size_t count = (size_t)bytes / sizeof(struct input_event);
+		for (size_t i = 0; i < count; i++) {
+			// The kernel's buffer overran: what follows up to the next
+			// report is incomplete, and edges were lost.
+			if (device.dropped) {
+				if (buffer[i].type == EV_SYN && buffer[i].code == SYN_REPORT) {
+					device.dropped = false;
+					Resync(fd, device);
+				}
+			} else if (buffer[i].type == EV_SYN && buffer[i].code == SYN_DROPPED) {
+				device.dropped = true;
+			} else {
+				ReadEvent(device, buffer[i]);
+			}
+		}
+
+		if ((size_t)bytes < sizeof(buffer))
+			return;
+	}
+}
+
+void EvdevSource::ReadEvent(Device &device, const struct input_event &event)
+{
+	// Value 2 is auto-repeat, which is not an edge.
+	if (event.type == EV_KEY && event.value != 2) {
+		if (event.code < KeyCount)
+			device.held[event.code] = event.value != 0;
+		m_sink({(keycode_t)event.code, event.value != 0});
+	}
+	if (m_inputSink)
+		ReadInput(event);
+}
+
+// Emits the edges that bring what was reported held in line with the keys
+// the device holds now. Nodes that can't tell, and closed devices (fd -1),
+// hold none.
+void EvdevSource::Resync(int fd, Device &device)
+{
+	static_assert(KeyCount == KEY_CNT, "KeyCount must match KEY_CNT");
+	unsigned char bits[KeyCount / 8] = {};
+	if (fd >= 0)
+		ioctl(fd, EVIOCGKEY(sizeof(bits)), bits);
+
+	struct input_event event = {};
+	event.type = EV_KEY;
+	for (uint16_t code = 0; code < KeyCount; code++) {
+		bool down = (bits[code / 8] >> (code % 8)) & 1;
+		if (device.held[code] == down)
+			continue;
+		event.code = code;
+		event.value = down;
+		ReadEvent(device, event);
+	}
+}
+
+void EvdevSource::ReadInput(const struct input_event &event)
+{
+	switch (event.type) {
+	case EV_KEY:
+		// BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_SIDE, BTN_EXTRA, ... are
+		// buttons 1, 2, 3, 4, 5, ...
+		if (event.code >= BTN_LEFT && event.code <= BTN_TASK) {
+			if (event.value == 2)
+				break;
+			uint32_t bit = 1u << (event.code - BTN_LEFT);
+			m_buttonsHeld = event.value ? m_buttonsHeld | bit : m_buttonsHeld & ~bit;
+			EmitInput(event.value ? InputType::MousePressed : InputType::MouseReleased, event.code - BTN_LEFT + 1, 0, 0);
+		} else {
+			EmitInput(event.value ? InputType::KeyDown : InputType::KeyUp, event.code, 0, 0);
+		}
+		break;
+
+	case EV_REL:
+		if (event.code == REL_X)
+			m_relX += event.value;
+		else if (event.code == REL_Y)
+			m_relY += event.value;
+		else if (event.code == REL_HWHEEL)
+			m_wheelX += event.value;
+		else if (event.code == REL_WHEEL)
+			m_wheelY += event.value;
+		break;
+
+	case EV_SYN:
+		if (m_relX || m_relY)
+			EmitInput(m_buttonsHeld ? InputType::MouseDragged : InputType::MouseMoved, 0, m_relX, m_relY);
+		if (m_wheelX || m_wheelY)
+			EmitInput(InputType::MouseWheel, 0, m_wheelX, m_wheelY);
+		m_relX = m_relY = m_wheelX = m_wheelY = 0;
+		break;
+	}
+}
+
+void EvdevSource::ReadNotifications()
+{
+	alignas(struct inotify_event) char buffer[4096];
+
+	while (true) {
+		ssize_t bytes = read(m_inotify, buffer, sizeof(buffer));
+		if (bytes <= 0)
+			return;
+
+		for (char *ptr = buffer; ptr < buffer + bytes;) {
+			struct inotify_event *event = reinterpret_cast<struct inotify_event *>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->len == 0 || !IsEventNode(event->name))
+				continue;
+
+			if (event->mask & (IN_CREATE | IN_ATTRIB)) {
+				OpenDevice(event->name);
+			} else if (event->mask & IN_DELETE) {
+				for (auto &device : m_devices) {
+					if (device.second.name == event->name) {
+						CloseDevice(device.first);
+						break;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "hotkey-engine.h"
+
+#include <atomic>
+#include <bitset>
+#include <map>
+#include <string>
+#include <thread>
+
+struct input_event;
+
+// The modifier keys as evdev reports them, plus the generic ones.
+KeyState EvdevKeyState();
+
+// Reads key and button transitions (plus pointer motion and wheel for the
+// input sink) from every event* node of an input
+// directory with a single epoll loop. New nodes are picked up through
+// inotify, so keyboards can be plugged in while the hook is running. Needs
+// read access to the nodes (usually membership of the "input" group) but no
+// display server. Any readable file that yields struct input_event records
+// works, which lets tests drive it from a FIFO.
+//
+// After a kernel buffer overrun (SYN_DROPPED) the held keys are read back
+// with EVIOCGKEY and the missed edges emitted; keys held on a device that
+// goes away are released.
+class EvdevSource : public KeyEventSource {
+public:
+	explicit EvdevSource(std::string directory = "/dev/input") : m_directory(std::move(directory)){};
+	~EvdevSource();
+
+	bool Start(Sink sink) override;
+	void Stop() override;
+	void Wake() override;
+
+	size_t DeviceCount() const { return m_deviceCount.load(); };
+
+private:
+	static const size_t KeyCount = 0x300; // KEY_CNT
+
+	struct Device {
+		std::string name;
+		std::bitset<KeyCount> held; // as reported through the sink
+		bool dropped = false;       // until the next SYN_REPORT
+	};
+
+	void Run();
+	void OpenDevice(const std::string &name);
+	void CloseDevice(int fd);
+	void ReadDevice(int fd);
+	void ReadEvent(Device &device, const struct input_event &event);
+	void ReadInput(const struct input_event &event);
+	void Resync(int fd, Device &device);
+	void ReadNotifications();
+	void EmitInput(InputType type, uint16_t code, int32_t x, int32_t y) { m_inputSink({type, 0, code, x, y, 0}); };
+
+	std::string m_directory;
+	Sink m_sink;
+	std::thread m_thread;
+
+	int m_epoll = -1;
+	int m_inotify = -1; // kept across runs
+	int m_watch = -1;
+	int m_wake = -1;
+	std::atomic<bool> m_stopping{false};
+
+	// Only touched by the reader thread once started.
+	std::map<int, Device> m_devices;
+	std::atomic<size_t> m_deviceCount{0};
+
+	// Relative motion and wheel accumulated until the next EV_SYN.
+	int32_t m_relX = 0, m_relY = 0, m_wheelX = 0, m_wheelY = 0;
+	uint32_t m_buttonsHeld = 0;
+};
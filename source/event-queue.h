@@ -0,0 +1,127 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+enum class OverflowPolicy : uint8_t {
+	DropNewest, // a full ring rejects the new item
+	DropOldest, // a full ring discards its oldest item to make room
+};
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Neither side ever blocks or allocates, so the producer can be an OS
+// input hook that must return quickly.
+//
+// Items are copied in and out as 64 bit atomic words. With DropOldest the
+// producer may take the oldest item away from the consumer; the consumer
+// claims each item with a compare-and-swap on the read index and throws its
+// copy away if it lost, so it never returns a half-overwritten item.
+template<class T> class SpscRing {
+	static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % sizeof(uint64_t) == 0, "ring items must be POD and a multiple of 8 bytes");
+	static const size_t Words = sizeof(T) / sizeof(uint64_t);
+
+public:
+	// Capacity is rounded up to a power of two.
+	explicit SpscRing(size_t capacity = 1024, OverflowPolicy policy = OverflowPolicy::DropNewest) : m_policy(policy)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+		m_mask = size - 1;
+		m_slots.reset(new std::atomic<uint64_t>[size * Words]);
+		for (size_t i = 0; i < size * Words; i++)
+			m_slots[i].store(0, std::memory_order_relaxed);
+	};
+
+	size_t Capacity() const { return m_mask + 1; };
+	OverflowPolicy Policy() const { return m_policy; };
+
+	// Items lost to overflow so far.
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); };
+
+	// Approximate when called from a third thread.
+	size_t Size() const { return (size_t)(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire)); };
+
+	// Producer only. Returns false if an item was dropped, either this one or
+	// the oldest queued one.
+	bool Push(const T &item)
+	{
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		bool dropped = false;
+
+		if (tail - head > m_mask) {
+			if (m_policy == OverflowPolicy::DropNewest) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			// If the consumer takes the oldest item first there's room anyway.
+			if (m_head.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				dropped = true;
+			}
+		}
+
+		uint64_t words[Words];
+		memcpy(words, &item, sizeof(T));
+		std::atomic<uint64_t> *slot = &m_slots[(tail & m_mask) * Words];
+		for (size_t i = 0; i < Words; i++)
+			slot[i].store(words[i], std::memory_order_relaxed);
+
+		m_tail.store(tail + 1, std::memory_order_release);
+		return !dropped;
+	};
+
+	// Consumer only.
+	bool Pop(T &item)
+	{
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		for (;;) {
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+
+			uint64_t words[Words];
+			const std::atomic<uint64_t> *slot = &m_slots[(head & m_mask) * Words];
+			for (size_t i = 0; i < Words; i++)
+				words[i] = slot[i].load(std::memory_order_relaxed);
+
+			// On failure head is reloaded and the copy is discarded.
+			if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				memcpy(&item, words, sizeof(T));
+				return true;
+			}
+		}
+	};
+
+private:
+	std::unique_ptr<std::atomic<uint64_t>[]> m_slots;
+	size_t m_mask;
+	OverflowPolicy m_policy;
+
+	// Read and write indices on their own cache lines; they only grow.
+	alignas(64) std::atomic<uint64_t> m_head{0};
+	alignas(64) std::atomic<uint64_t> m_tail{0};
+	alignas(64) std::atomic<uint64_t> m_dropped{0};
+};
@@ -0,0 +1,748 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "hook-client.h"
+#include "key-names.h"
+
+#include <algorithm>
+#include <chrono>
+
+// evdev only knows relative motion.
+#ifdef __linux__
+static const bool RelativeMotion = true;
+#else
+static const bool RelativeMotion = false;
+#endif
+
+static uint64_t NowNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HookClient::HookClient(Napi::Env env)
+	: env(env), engine([this](ChordId id, KeyEdge edge) { delivery.Push(id, edge); }, PlatformKeyState())
+{
+	// Registered before any thread-safe function, so it runs after them and
+	// after the CaptureHub's detach.
+	napi_add_env_cleanup_hook(env, OnEnvCleanup, this);
+}
+
+// Brings the OS hook up or down on the libuv threadpool. The client joins
+// the fan-out, or has already left it, on its JS thread.
+class CaptureWorker : public Napi::AsyncWorker {
+public:
+	CaptureWorker(HookClient &client, bool start)
+		: Napi::AsyncWorker(client.env), m_client(client), m_start(start), m_deferred(Napi::Promise::Deferred::New(client.env)){};
+	~CaptureWorker()
+	{
+		// The environment went away before it could join.
+		if (m_acquired)
+			GetCaptureHub().Release();
+	};
+
+	Napi::Promise Promise() const { return m_deferred.Promise(); };
+
+	void Execute() override
+	{
+		if (m_start)
+			m_acquired = GetCaptureHub().Acquire();
+		else
+			GetCaptureHub().Release();
+	};
+
+	void OnOK() override
+	{
+		bool ok = !m_start;
+		if (m_acquired) {
+			m_acquired = false;
+			ok = m_client.m_started = GetCaptureHub().Join(m_client);
+			if (!ok)
+				GetCaptureHub().Release();
+		}
+		m_client.m_pending = false;
+		m_deferred.Resolve(Napi::Boolean::New(Env(), ok));
+	};
+
+private:
+	HookClient &m_client;
+	bool m_start;
+	bool m_acquired = false;
+	Napi::Promise::Deferred m_deferred;
+};
+
+// Arms a lazy client: the OS hook comes up on the libuv threadpool, the
+// client joins on its JS thread if it still wants to.
+class ArmWorker : public Napi::AsyncWorker {
+public:
+	explicit ArmWorker(HookClient &client) : Napi::AsyncWorker(client.env), m_client(client), m_startNs(NowNs()){};
+	~ArmWorker()
+	{
+		if (m_acquired)
+			GetCaptureHub().Release();
+	};
+
+	void Execute() override { m_acquired = GetCaptureHub().Acquire(); };
+
+	void OnOK() override
+	{
+		m_client.m_arming = false;
+		if (m_acquired) {
+			m_acquired = false;
+			m_client.Armed(m_startNs);
+		}
+	};
+
+private:
+	HookClient &m_client;
+	uint64_t m_startNs;
+	bool m_acquired = false;
+};
+
+static Napi::Promise Resolved(Napi::Env env, bool value)
+{
+	Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+	deferred.Resolve(Napi::Boolean::New(env, value));
+	return deferred.Promise();
+}
+
+bool HookClient::Start(bool lazy, uint32_t parkAfterMs)
+{
+	if (m_started || m_pending)
+		return false;
+
+	if (!lazy) {
+		m_started = GetCaptureHub().Attach(*this);
+		return m_started;
+	}
+
+	if (!m_parkTimer) {
+		uv_loop_t *loop = nullptr;
+		napi_get_uv_event_loop(env, &loop);
+		m_parkTimer = new uv_timer_t;
+		uv_timer_init(loop, m_parkTimer);
+		m_parkTimer->data = this;
+		// Parking later doesn't keep the process alive.
+		uv_unref(reinterpret_cast<uv_handle_t *>(m_parkTimer));
+	}
+
+	m_started = true;
+	m_lazy = true;
+	m_parkAfterMs = parkAfterMs;
+	Update();
+	return true;
+}
+
+bool HookClient::Stop()
+{
+	if (!m_started || m_pending)
+		return false;
+
+	if (m_parkTimer)
+		uv_timer_stop(m_parkTimer);
+	m_started = false;
+	m_lazy = false;
+	GetCaptureHub().Detach(*this);
+	return true;
+}
+
+Napi::Promise HookClient::StartAsync(bool lazy, uint32_t parkAfterMs)
+{
+	if (lazy || m_started || m_pending)
+		return Resolved(env, Start(lazy, parkAfterMs));
+
+	CaptureWorker *worker = new CaptureWorker(*this, true);
+	m_pending = true;
+	worker->Queue();
+	return worker->Promise();
+}
+
+Napi::Promise HookClient::StopAsync()
+{
+	if (!m_started || m_pending)
+		return Resolved(env, false);
+
+	if (m_parkTimer)
+		uv_timer_stop(m_parkTimer);
+	m_started = false;
+	m_lazy = false;
+	// A parked lazy client has nothing to release.
+	if (!GetCaptureHub().Leave(*this))
+		return Resolved(env, true);
+
+	CaptureWorker *worker = new CaptureWorker(*this, false);
+	m_pending = true;
+	worker->Queue();
+	return worker->Promise();
+}
+
+void HookClient::Update()
+{
+	if (!m_lazy)
+		return;
+
+	if (Needed()) {
+		uv_timer_stop(m_parkTimer);
+		if (!attached)
+			Arm();
+	} else if (attached) {
+		if (m_parkAfterMs == 0)
+			Park();
+		else if (!uv_is_active(reinterpret_cast<uv_handle_t *>(m_parkTimer)))
+			uv_timer_start(m_parkTimer, OnParkTimer, m_parkAfterMs, 0);
+	}
+}
+
+void HookClient::Arm()
+{
+	if (m_arming)
+		return;
+	m_arming = true;
+	(new ArmWorker(*this))->Queue();
+}
+
+void HookClient::Armed(uint64_t startNs)
+{
+	// Stopped, or started for good, while it was arming.
+	if (!m_lazy || !GetCaptureHub().Join(*this)) {
+		GetCaptureHub().Release();
+		return;
+	}
+
+	DeliveryStats &stats = delivery.Stats();
+	stats.arm.Record(NowNs() - startNs);
+	stats.arms.fetch_add(1, std::memory_order_relaxed);
+	// The bindings may have gone in the meantime.
+	Update();
+}
+
+void HookClient::Park()
+{
+	if (GetCaptureHub().Detach(*this))
+		delivery.Stats().parks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HookClient::OnParkTimer(uv_timer_t *timer)
+{
+	HookClient *client = static_cast<HookClient *>(timer->data);
+	if (client->m_lazy && !client->Needed())
+		client->Park();
+}
+
+void HookClient::OnEnvCleanup(void *arg)
+{
+	HookClient *client = static_cast<HookClient *>(arg);
+	client->stream.Close();
+	if (client->m_parkTimer) {
+		uv_close(reinterpret_cast<uv_handle_t *>(client->m_parkTimer), [](uv_handle_t *handle) { delete reinterpret_cast<uv_timer_t *>(handle); });
+		client->m_parkTimer = nullptr;
+	}
+}
+
+HookClient &GetHookClient(Napi::Env env)
+{
+	return *env.GetInstanceData<HookClient>();
+}
+
+HotkeyDelivery &GetHotkeyDelivery(Napi::Env env)
+{
+	return GetHookClient(env).delivery;
+}
+
+InputStream &GetInputStream(Napi::Env env)
+{
+	return GetHookClient(env).stream;
+}
+
+bool CaptureHub::Attach(HookClient &client)
+{
+	if (client.attached || !Acquire())
+		return false;
+	return Join(client);
+}
+
+bool CaptureHub::Detach(HookClient &client)
+{
+	if (!Leave(client))
+		return false;
+	Release();
+	return true;
+}
+
+CaptureHub::CaptureHub() : m_owned(new ClientList()), m_clients(m_owned.get()), m_pressed(PlatformKeyState())
+{
+#ifdef __APPLE__
+	// The hook thread always ran raised there.
+	m_options.policy = ThreadPolicy::High;
+	m_optionsSet = true;
+#endif
+}
+
+bool CaptureHub::Acquire()
+{
+	std::lock_guard<std::mutex> lock(m_captureMtx);
+	if (m_users == 0) {
+		// No capture thread writes it now.
+		m_pressed.Reset();
+		{
+			// A new thread, which has to take the options again.
+			std::lock_guard<std::mutex> options(m_optionsMtx);
+			m_optionsApplied = false;
+			m_optionsPending.store(m_optionsSet, std::memory_order_release);
+		}
+		if (!StartCapture())
+			return false;
+		m_capturing.store(true, std::memory_order_release);
+	}
+	m_users++;
+	return true;
+}
+
+void CaptureHub::Release()
+{
+	std::lock_guard<std::mutex> lock(m_captureMtx);
+	if (m_users > 0 && --m_users == 0) {
+		m_capturing.store(false, std::memory_order_release);
+		StopCapture();
+	}
+}
+
+void CaptureHub::SetThreadOptions(const ThreadOptions &options)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_optionsMtx);
+		m_options = options;
+		m_optionsSet = true;
+		m_optionsApplied = false;
+		m_optionsPending.store(true, std::memory_order_release);
+	}
+
+	// A running capture thread may be asleep until the next event.
+	std::lock_guard<std::mutex> lock(m_captureMtx);
+	if (m_users > 0)
+		WakeCapture();
+}
+
+bool CaptureHub::GetThreadOptions(ThreadOptions &options)
+{
+	std::lock_guard<std::mutex> lock(m_optionsMtx);
+	options = m_optionsApplied ? m_appliedOptions : m_options;
+	return m_optionsApplied;
+}
+
+void CaptureHub::TakeThreadOptions()
+{
+	// Options set from here on leave it pending again, for the next wake.
+	m_optionsPending.store(false, std::memory_order_relaxed);
+	ThreadOptions options;
+	{
+		std::lock_guard<std::mutex> lock(m_optionsMtx);
+		options = m_options;
+	}
+
+	ThreadOptions applied = ApplyThreadOptions(options);
+
+	std::lock_guard<std::mutex> lock(m_optionsMtx);
+	if (!m_optionsPending.load(std::memory_order_relaxed)) {
+		m_appliedOptions = applied;
+		m_optionsApplied = true;
+	}
+}
+
+void CaptureHub::GetPressedKeys(std::vector<keycode_t> &keys) const
+{
+	keys.clear();
+	if (m_capturing.load(std::memory_order_acquire))
+		m_pressed.Snapshot(keys);
+}
+
+bool CaptureHub::Join(HookClient &client)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	if (client.attached)
+		return false;
+
+	// Whatever it saw before it left is stale, releases were missed.
+	client.engine.ResetState();
+	client.delivery.Start(client.env);
+	client.stream.Start(client.env, RelativeMotion);
+
+	std::unique_ptr<ClientList> next(new ClientList(*m_owned));
+	next->push_back(&client);
+	Publish(std::move(next));
+
+	// Registered after the queues' thread-safe functions, so it runs before
+	// their own cleanup.
+	napi_add_env_cleanup_hook(client.env, OnEnvCleanup, &client);
+	client.attached = true;
+	return true;
+}
+
+bool CaptureHub::Leave(HookClient &client)
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	if (!client.attached)
+		return false;
+
+	napi_remove_env_cleanup_hook(client.env, OnEnvCleanup, &client);
+	Remove(client);
+	return true;
+}
+
+void CaptureHub::OnEnvCleanup(void *client)
+{
+	CaptureHub &hub = GetCaptureHub();
+	{
+		std::lock_guard<std::mutex> lock(hub.m_mtx);
+		hub.Remove(*(HookClient *)client);
+	}
+	hub.Release();
+}
+
+size_t CaptureHub::Clients()
+{
+	std::lock_guard<std::mutex> lock(m_mtx);
+	return m_owned->size();
+}
+
+void CaptureHub::Remove(HookClient &client)
+{
+	std::unique_ptr<ClientList> next(new ClientList(*m_owned));
+	next->erase(std::remove(next->begin(), next->end(), &client), next->end());
+	Publish(std::move(next));
+
+	// The capture thread is out of the client, its queues can go.
+	client.delivery.Stop();
+	client.stream.Stop();
+	client.attached = false;
+}
+
+void CaptureHub::Publish(std::unique_ptr<ClientList> next)
+{
+	std::unique_ptr<ClientList> old = std::move(m_owned);
+	m_owned = std::move(next);
+	m_clients.store(m_owned.get());
+
+	// A dispatch that starts from here on sees the new list. One that is
+	// under way may still be on the old one, wait for it to finish.
+	m_dispatch.Wait();
+}
+
+bool CaptureHub::OnKeyEvent(const KeyEvent &event)
+{
+	bool consume = false;
+	m_pressed.Update(event);
+	m_dispatch.Begin();
+	for (HookClient *client : *m_clients.load()) {
+		client->delivery.Captured();
+		consume |= client->engine.OnKeyEvent(event);
+	}
+	m_dispatch.End();
+	return consume;
+}
+
+void CaptureHub::OnInput(const InputEvent &event)
+{
+	m_dispatch.Begin();
+	for (HookClient *client : *m_clients.load())
+		client->stream.Push(event);
+	m_dispatch.End();
+}
+
+int32_t CaptureHub::OnTimer()
+{
+	if (m_optionsPending.load(std::memory_order_acquire))
+		TakeThreadOptions();
+	int32_t wait = -1;
+	m_dispatch.Begin();
+	for (HookClient *client : *m_clients.load()) {
+		if (client->engine.Timers() == 0)
+			continue;
+		client->delivery.Ticked();
+		int32_t next = client->engine.Tick();
+		if (next >= 0 && (wait < 0 || next < wait))
+			wait = next;
+	}
+	m_dispatch.End();
+	return wait;
+}
+
+CaptureHub &GetCaptureHub()
+{
+	static CaptureHub hub;
+	return hub;
+}
+
+static void ParseStartOptions(const Napi::CallbackInfo &info, bool &lazy, uint32_t &parkAfterMs)
+{
+	/* interface IStartHookOptions {
+	 *   lazy?: boolean;       // only hook while something is registered
+	 *   parkAfterMs?: number; // grace period after the last binding is gone
+	 * }
+	 */
+	lazy = false;
+	parkAfterMs = 0;
+	if (info.Length() > 0 && info[0].IsObject()) {
+		Napi::Object options = info[0].ToObject();
+		lazy = options.Get("lazy").ToBoolean().Value();
+		if (options.Has("parkAfterMs"))
+			parkAfterMs = options.Get("parkAfterMs").ToNumber().Uint32Value();
+	}
+}
+
+Napi::Value StartHotkeyThreadJS(const Napi::CallbackInfo &info)
+{
+	bool lazy;
+	uint32_t parkAfterMs;
+	ParseStartOptions(info, lazy, parkAfterMs);
+	return Napi::Boolean::New(info.Env(), GetHookClient(info.Env()).Start(lazy, parkAfterMs));
+}
+
+Napi::Value StopHotkeyThreadJS(const Napi::CallbackInfo &info)
+{
+	return Napi::Boolean::New(info.Env(), GetHookClient(info.Env()).Stop());
+}
+
+Napi::Value StartHookAsyncJS(const Napi::CallbackInfo &info)
+{
+	// Resolves to what startHook() would have returned.
+	bool lazy;
+	uint32_t parkAfterMs;
+	ParseStartOptions(info, lazy, parkAfterMs);
+	return GetHookClient(info.Env()).StartAsync(lazy, parkAfterMs);
+}
+
+Napi::Value StopHookAsyncJS(const Napi::CallbackInfo &info)
+{
+	return GetHookClient(info.Env()).StopAsync();
+}
+
+Napi::Value IsKeyDownJS(const Napi::CallbackInfo &info)
+{
+	keycode_t key;
+	bool down = g_KeyNames.Find(info[0].ToString().Utf8Value(), key) && GetCaptureHub().IsKeyDown(key);
+	return Napi::Boolean::New(info.Env(), down);
+}
+
+Napi::Value GetPressedKeysJS(const Napi::CallbackInfo &info)
+{
+	// Names of the keys held at one instant, codes without a name are left
+	// out.
+	std::vector<keycode_t> keys;
+	GetCaptureHub().GetPressedKeys(keys);
+
+	Napi::Array names = Napi::Array::New(info.Env());
+	for (keycode_t key : keys) {
+		if (const char *name = KeyNameOf(key))
+			names.Set(names.Length(), Napi::String::New(info.Env(), name));
+	}
+	return names;
+}
+
+Napi::Value SetCaptureThreadOptionsJS(const Napi::CallbackInfo &info)
+{
+	/* interface ICaptureThreadOptions {
+	 *   policy?: 'normal' | 'high' | 'realtime';
+	 *   priority?: number;          // within the policy, see thread-options.h
+	 *   affinity?: number[] | number; // CPU indices, or a mask of CPUs 0-52
+	 * }
+	 * Returns false for invalid options. Refused policies fall back, see
+	 * getCaptureThreadOptions() for what took effect.
+	 */
+	if (info.Length() < 1 || !info[0].IsObject())
+		return Napi::Boolean::New(info.Env(), false);
+
+	Napi::Object object = info[0].ToObject();
+	ThreadOptions options;
+	if (object.Has("policy") && !ParseThreadPolicy(object.Get("policy").ToString().Utf8Value(), options.policy))
+		return Napi::Boolean::New(info.Env(), false);
+	if (object.Has("priority"))
+		options.priority = object.Get("priority").ToNumber().Int32Value();
+
+	Napi::Value affinity = object.Get("affinity");
+	if (affinity.IsArray()) {
+		Napi::Array cpus = affinity.As<Napi::Array>();
+		for (uint32_t i = 0; i < cpus.Length(); i++) {
+			uint32_t cpu = cpus.Get(i).ToNumber().Uint32Value();
+			if (cpu >= 64)
+				return Napi::Boolean::New(info.Env(), false);
+			options.affinity |= 1ULL << cpu;
+		}
+	} else if (affinity.IsNumber()) {
+		double mask = affinity.ToNumber().DoubleValue();
+		if (!(mask >= 0 && mask <= 9007199254740991.0))
+			return Napi::Boolean::New(info.Env(), false);
+		options.affinity = (uint64_t)mask;
+	}
+
+	GetCaptureHub().SetThreadOptions(options);
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value GetCaptureThreadOptionsJS(const Napi::CallbackInfo &info)
+{
+	// The options in effect, or the requested ones with applied: false until
+	// the capture thread took them.
+	ThreadOptions options;
+	bool applied = GetCaptureHub().GetThreadOptions(options);
+
+	Napi::Array cpus = Napi::Array::New(info.Env());
+	for (uint32_t cpu = 0; cpu < 64; cpu++) {
+		if (options.affinity >> cpu & 1)
+			cpus.Set(cpus.Length(), Napi::Number::New(info.Env(), cpu));
+	}
+
+	Napi::Object result = Napi::Object::New(info.Env());
+	result.Set("policy", Napi::String::New(info.Env(), ThreadPolicyName(options.policy)));
+	result.Set("priority", Napi::Number::New(info.Env(), options.priority));
+	result.Set("affinity", cpus);
+	result.Set("applied", Napi::Boolean::New(info.Env(), applied));
+	return result;
+}
+
+// The new table is built while the hook keeps matching on the current one,
+// then published as a whole.
+static Napi::Value RegisterBindings(const Napi::CallbackInfo &info, bool replace)
+{
+	HookClient &client = GetHookClient(info.Env());
+	std::vector<HotkeyBinding> bindings;
+	Napi::Array results = ParseHotkeyBindings(info[0], StringToChord, replace, bindings);
+
+	std::unique_ptr<HotkeyTable> table(replace ? new HotkeyTable() : client.engine.CopyTable().release());
+	for (const HotkeyBinding &binding : bindings) {
+		const uint32_t *slot = table->FindSlot(binding.id);
+		bool consume = binding.consume || (slot && table->Slot(*slot).consume);
+		client.engine.SetHotkey(*table, binding.id, binding.chord, consume);
+	}
+
+	if (replace)
+		client.delivery.Clear();
+	for (const HotkeyBinding &binding : bindings)
+		client.delivery.SetCallback(binding.id, binding.edge, binding.callback);
+
+	client.engine.Publish(std::move(table));
+	client.Update();
+	return results;
+}
+
+Napi::Value RegisterCallbacksJS(const Napi::CallbackInfo &info)
+{
+	/* Takes an array of INodeLibuiohookBinding. Returns an array with true
+	 * for each registered entry, or why it was rejected: 'unknown key',
+	 * 'invalid event type', 'invalid callback' or 'already registered'.
+	 */
+	return RegisterBindings(info, false);
+}
+
+Napi::Value ReplaceAllCallbacksJS(const Napi::CallbackInfo &info)
+{
+	// Like registerCallbacks() after unregisterAllCallbacks(), sequences are
+	// dropped as well, but the hook never sees an empty table in between.
+	return RegisterBindings(info, true);
+}
+
+Napi::Value GetBindingIdJS(const Napi::CallbackInfo &info)
+{
+	// Matches the bindingId of batched records, -1 for unknown keys.
+	Napi::Object binds = info[0].ToObject();
+
+	Chord chord;
+	if (!StringToChord(binds.Get("key").ToString().Utf8Value(), binds.Get("modifiers").ToObject(), chord))
+		return Napi::Number::New(info.Env(), -1);
+
+	return Napi::Number::New(info.Env(), (double)MakeChordId(chord));
+}
+
+Napi::Value RegisterSequenceJS(const Napi::CallbackInfo &info)
+{
+	/* interface ISequenceBinding {
+	 *   steps: { key: string; modifiers?: IModifiers; timeout?: number }[];
+	 *   timeout?: number; // ms allowed between steps, 1000 by default
+	 *   callback: () => void;
+	 * }
+	 * Returns the binding id, -1 if a key is unknown or the sequence is a
+	 * prefix of another one or extends one. Steps match their modifiers
+	 * exactly, also on macOS where single chords allow extra ones.
+	 */
+	HookClient &client = GetHookClient(info.Env());
+	Napi::Object binds = info[0].ToObject();
+	std::vector<SequenceTrie::Step> steps;
+	if (!binds.Get("callback").IsFunction() || !ParseSequenceSteps(binds, StringToChord, steps))
+		return Napi::Number::New(info.Env(), -1);
+
+	ChordId id = NextSequenceId();
+	if (!client.engine.SetSequence(id, steps))
+		return Napi::Number::New(info.Env(), -1);
+	client.delivery.SetCallback(id, KeyEdge::Pressed, binds.Get("callback").As<Napi::Function>());
+	client.Update();
+	return Napi::Number::New(info.Env(), (double)id);
+}
+
+Napi::Value UnregisterSequenceJS(const Napi::CallbackInfo &info)
+{
+	HookClient &client = GetHookClient(info.Env());
+	ChordId id = (ChordId)info[0].ToNumber().Int64Value();
+	// Gestures share the id space.
+	if (!client.engine.Table().Sequences().Contains(id) || !client.delivery.RemoveCallback(id, KeyEdge::Pressed))
+		return Napi::Boolean::New(info.Env(), false);
+
+	client.engine.RemoveSequence(id);
+	client.Update();
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value RegisterGestureJS(const Napi::CallbackInfo &info)
+{
+	/* interface IGestureBinding {
+	 *   kind: 'hold' | 'longPress' | 'doubleTap';
+	 *   key: string;
+	 *   modifiers?: IModifiers;
+	 *   ms?: number; // hold time (300, longPress 600) or gap between taps (300)
+	 *   callback: () => void;
+	 *   releaseCallback?: () => void; // hold only, when let go after it fired
+	 * }
+	 * Returns the binding id, -1 if the key or kind is unknown.
+	 */
+	HookClient &client = GetHookClient(info.Env());
+	Napi::Object binds = info[0].ToObject();
+	Gesture gesture;
+	if (!binds.Get("callback").IsFunction() || !ParseGesture(binds, StringToChord, gesture))
+		return Napi::Number::New(info.Env(), -1);
+
+	gesture.id = NextSequenceId();
+	if (!client.engine.SetGesture(gesture))
+		return Napi::Number::New(info.Env(), -1);
+	client.delivery.SetCallback(gesture.id, KeyEdge::Pressed, binds.Get("callback").As<Napi::Function>());
+	if (gesture.kind == GestureKind::Hold && binds.Get("releaseCallback").IsFunction())
+		client.delivery.SetCallback(gesture.id, KeyEdge::Released, binds.Get("releaseCallback").As<Napi::Function>());
+	client.Update();
+	return Napi::Number::New(info.Env(), (double)gesture.id);
+}
+
+Napi::Value UnregisterGestureJS(const Napi::CallbackInfo &info)
+{
+	HookClient &client = GetHookClient(info.Env());
+	ChordId id = (ChordId)info[0].ToNumber().Int64Value();
+	// Sequences share the id space.
+	if (!client.engine.Table().FindGesture(id) || !client.delivery.RemoveCallback(id, KeyEdge::Pressed))
+		return Napi::Boolean::New(info.Env(), false);
+
+	client.delivery.RemoveCallback(id, KeyEdge::Released);
+	client.engine.RemoveGesture(id);
+	client.Update();
+	return Napi::Boolean::New(info.Env(), true);
+}
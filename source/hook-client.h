@@ -0,0 +1,205 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "dispatch-sequence.h"
+#include "hotkey-delivery.h"
+#include "hotkey-engine.h"
+#include "input-stream.h"
+#include "pressed-keys.h"
+#include "thread-options.h"
+
+#include <napi.h>
+#include <uv.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// What one JS environment owns. Every environment that loads the module (the
+// main thread, each worker, each Electron renderer sharing the process) gets
+// its own HookClient as instance data, so bindings, queues and callbacks of
+// different environments never mix. Only the OS hook is shared, through the
+// CaptureHub.
+//
+// startHook either attaches right away, or lazily: then the client is only
+// attached while it has bindings, subscriptions or a recording. The first one
+// arms the hook, and it parks again once the last one is gone, optionally
+// after a grace period so a quick re-register doesn't reinstall the OS hook. A
+// parked process with no other client costs no CPU and holds no system-wide
+// hook. Arming brings the OS hook up on the libuv threadpool, so the
+// registering call never waits for it.
+//
+// The async variants bring the OS hook up or down on the libuv threadpool, so
+// the JS thread never waits for it; lazy starts resolve right away. While one
+// is under way, other starts and stops fail.
+//
+// Everything runs on the environment's JS thread.
+struct HookClient {
+	explicit HookClient(Napi::Env env);
+
+	bool Start(bool lazy, uint32_t parkAfterMs);
+	bool Stop();
+	Napi::Promise StartAsync(bool lazy, uint32_t parkAfterMs);
+	Napi::Promise StopAsync();
+	// Call after bindings, subscriptions or the recording changed.
+	void Update();
+
+	Napi::Env env;
+	HotkeyDelivery delivery;
+	InputStream stream;
+	HotkeyEngine engine; // fires into delivery
+
+	bool attached = false; // set by the CaptureHub
+
+private:
+	friend class CaptureWorker;
+	friend class ArmWorker;
+
+	bool Needed() const { return delivery.Bindings() > 0 || stream.Subscriptions() > 0 || stream.Recording(); };
+	void Arm();
+	void Armed(uint64_t startNs);
+	void Park();
+	static void OnParkTimer(uv_timer_t *timer);
+	static void OnEnvCleanup(void *client);
+
+	bool m_started = false;
+	bool m_pending = false; // async start or stop
+	bool m_arming = false;
+	bool m_lazy = false;
+	uint32_t m_parkAfterMs = 0;
+	uv_timer_t *m_parkTimer = nullptr; // freed once closed
+};
+
+// Created by the module's Init.
+HookClient &GetHookClient(Napi::Env env);
+
+// The one capture thread of the process. The first environment to start the
+// hook starts it, and it stops when the last one stops or goes away; N
+// windows cost one OS hook instead of N. Every event is fanned out to the
+// environments attached at that moment, each matching its own bindings.
+//
+// Attaching is two steps: Acquire counts the environment as a user of the OS
+// hook and starts it for the first one, which may block, so it can run on
+// any thread; Join then adds the environment to the fan-out on its JS thread.
+// Detaching is Leave, then Release.
+//
+// The capture thread never locks. Joining and leaving swap the whole list
+// under a mutex only the JS threads take, and a leaving environment waits
+// until the capture thread is done with the old list before it stops its
+// delivery, so no event reaches it afterwards.
+//
+// An environment that is torn down while attached detaches itself, from a
+// cleanup hook that runs before its queues' thread-safe functions go away.
+//
+// The capture thread applies the scheduling options (see ThreadOptions) to
+// itself when it starts, before it waits for the first event, and is woken to
+// apply them again when they change while it runs.
+//
+// The hub also keeps which keys are held, for isKeyDown and getPressedKeys.
+// Only keys pressed while the OS hook runs are known; nothing is held while it
+// is stopped.
+class CaptureHub {
+public:
+	CaptureHub();
+
+	// JS thread of the client. False if it already is or isn't attached, or
+	// the OS hook failed to start.
+	bool Attach(HookClient &client);
+	bool Detach(HookClient &client);
+
+	// Any thread. Acquire is false if the OS hook failed to start.
+	bool Acquire();
+	void Release();
+	// JS thread of the client, false if it already is or isn't joined.
+	bool Join(HookClient &client);
+	bool Leave(HookClient &client);
+
+	size_t Clients();
+
+	// Any thread, without locks.
+	bool IsKeyDown(keycode_t key) const { return m_capturing.load(std::memory_order_acquire) && m_pressed.IsDown(key); };
+	void GetPressedKeys(std::vector<keycode_t> &keys) const;
+
+	// Any thread.
+	void SetThreadOptions(const ThreadOptions &options);
+	// What the capture thread applied, false while it hasn't taken the
+	// latest options yet; then options are the requested ones.
+	bool GetThreadOptions(ThreadOptions &options);
+
+	// Capture thread only. Expects a single capture thread that calls them
+	// one after the other. OnKeyEvent is true if any environment consumes
+	// the event; the backend swallows it if it can.
+	bool OnKeyEvent(const KeyEvent &event);
+	void OnInput(const InputEvent &event);
+	// Runs the gesture timers that are due. Returns the milliseconds until the
+	// next one, -1 if none; the backend calls it again by then.
+	int32_t OnTimer();
+
+private:
+	typedef std::vector<HookClient *> ClientList;
+
+	void Remove(HookClient &client);
+	void TakeThreadOptions();
+	void Publish(std::unique_ptr<ClientList> next);
+	static void OnEnvCleanup(void *client);
+
+	std::mutex m_mtx;                  // JS threads only
+	std::unique_ptr<ClientList> m_owned; // under m_mtx
+	std::atomic<const ClientList *> m_clients;
+	DispatchSequence m_dispatch;
+
+	std::mutex m_captureMtx; // held while the OS hook starts or stops
+	size_t m_users = 0;      // under m_captureMtx
+
+	PressedKeys m_pressed; // written by the capture thread
+	std::atomic<bool> m_capturing{false};
+
+	std::mutex m_optionsMtx;
+	ThreadOptions m_options, m_appliedOptions; // under m_optionsMtx
+	bool m_optionsSet = false, m_optionsApplied = false;
+	std::atomic<bool> m_optionsPending{false}; // for the capture thread, at OnTimer
+};
+
+CaptureHub &GetCaptureHub();
+
+Napi::Value StartHotkeyThreadJS(const Napi::CallbackInfo &info);
+Napi::Value StopHotkeyThreadJS(const Napi::CallbackInfo &info);
+Napi::Value StartHookAsyncJS(const Napi::CallbackInfo &info);
+Napi::Value StopHookAsyncJS(const Napi::CallbackInfo &info);
+Napi::Value SetCaptureThreadOptionsJS(const Napi::CallbackInfo &info);
+Napi::Value GetCaptureThreadOptionsJS(const Napi::CallbackInfo &info);
+Napi::Value IsKeyDownJS(const Napi::CallbackInfo &info);
+Napi::Value GetPressedKeysJS(const Napi::CallbackInfo &info);
+Napi::Value RegisterGestureJS(const Napi::CallbackInfo &info);
+Napi::Value UnregisterGestureJS(const Napi::CallbackInfo &info);
+Napi::Value RegisterSequenceJS(const Napi::CallbackInfo &info);
+Napi::Value UnregisterSequenceJS(const Napi::CallbackInfo &info);
+Napi::Value RegisterCallbacksJS(const Napi::CallbackInfo &info);
+Napi::Value ReplaceAllCallbacksJS(const Napi::CallbackInfo &info);
+Napi::Value GetBindingIdJS(const Napi::CallbackInfo &info);
+
+// Implemented by each backend. The OS hook feeds GetCaptureHub() from its
+// thread between StartCapture and StopCapture. WakeCapture makes that thread
+// call OnTimer soon.
+bool StartCapture();
+void StopCapture();
+void WakeCapture();
+KeyState PlatformKeyState();
+// Parses a binding's key name and modifiers the way the backend matches them.
+bool StringToChord(const std::string &key, Napi::Object modifiers, Chord &chord);
@@ -0,0 +1,135 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "hook.h"
+#include "hook-client.h"
+#include "evdev-source.h"
+#include "key-names.h"
+
+#include <vector>
+
+static EvdevSource g_source;
+
+KeyState PlatformKeyState()
+{
+	return EvdevKeyState();
+}
+
+bool StartCapture()
+{
+	g_source.SetInputSink([](const InputEvent &event) { GetCaptureHub().OnInput(event); });
+	g_source.SetTimerSink([]() { return GetCaptureHub().OnTimer(); });
+	if (g_source.Start([](const KeyEvent &event) { GetCaptureHub().OnKeyEvent(event); }))
+		return true;
+
+	std::cout << "Unable to watch /dev/input, is the user in the input group?" << std::endl;
+	return false;
+}
+
+void StopCapture()
+{
+	g_source.Stop();
+}
+
+void WakeCapture()
+{
+	g_source.Wake();
+}
+
+bool StringToChord(const std::string &keystr, Napi::Object modifiers, Chord &chord)
+{
+	keycode_t key;
+	if (!g_KeyNames.Find(keystr, key))
+		return false;
+
+	bool modShift, modCtrl, modAlt, modMeta;
+	modShift = modifiers.Get("shift").ToBoolean().Value();
+	modCtrl = modifiers.Get("ctrl").ToBoolean().Value();
+	modAlt = modifiers.Get("alt").ToBoolean().Value();
+	modMeta = modifiers.Get("meta").ToBoolean().Value();
+
+	chord.key = key;
+	chord.modifiers = (modShift ? MOD_SHIFT : 0) | (modCtrl ? MOD_CTRL : 0) | (modAlt ? MOD_ALT : 0) | (modMeta ? MOD_META : 0);
+	chord.care = MOD_ALL;
+	return true;
+}
+
+Napi::Value RegisterHotkeyJS(const Napi::CallbackInfo &info)
+{
+	HookClient &client = GetHookClient(info.Env());
+	Napi::Object binds = info[0].ToObject();
+	std::string keyString = binds.Get("key").ToString().Utf8Value();
+	std::string eventString = binds.Get("eventType").ToString().Utf8Value();
+
+	Chord chord;
+	if (!StringToChord(keyString, binds.Get("modifiers").ToObject(), chord)) {
+		std::cout << "Key not found!, key received: " << keyString.c_str() << std::endl;
+		return Napi::Boolean::New(info.Env(), false);
+	}
+
+	if (eventString != "registerKeydown" && eventString != "registerKeyup") {
+		std::cout << "Invalid event receive: " << eventString.c_str() << std::endl;
+		return Napi::Boolean::New(info.Env(), false);
+	}
+
+	ChordId id = MakeChordId(chord);
+	KeyEdge edge = eventString == "registerKeydown" ? KeyEdge::Pressed : KeyEdge::Released;
+	if (!client.delivery.SetCallback(id, edge, binds.Get("callback").As<Napi::Function>()))
+		return Napi::Boolean::New(info.Env(), false);
+
+	// consume sticks to the chord once any of its callbacks asked for it.
+	bool consume = binds.Get("consume").ToBoolean().Value() || client.engine.Consumes(id);
+	client.engine.SetHotkey(id, chord, consume);
+	client.Update();
+
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value UnregisterHotkeyJS(const Napi::CallbackInfo &info)
+{
+	HookClient &client = GetHookClient(info.Env());
+	Napi::Object binds = info[0].ToObject();
+	std::string keyString = binds.Get("key").ToString().Utf8Value();
+	std::string eventString = binds.Get("eventType").ToString().Utf8Value();
+
+	Chord chord;
+	if (!StringToChord(keyString, binds.Get("modifiers").ToObject(), chord))
+		return Napi::Boolean::New(info.Env(), false);
+
+	ChordId id = MakeChordId(chord);
+	KeyEdge edge = eventString == "registerKeydown" ? KeyEdge::Pressed : KeyEdge::Released;
+	if (!client.delivery.RemoveCallback(id, edge))
+		return Napi::Boolean::New(info.Env(), false);
+
+	// If both callbacks were removed, stop matching the chord.
+	if (!client.delivery.HasCallbacks(id))
+		client.engine.RemoveHotkey(id);
+	client.Update();
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value UnregisterHotkeysJS(const Napi::CallbackInfo &info)
+{
+	HookClient &client = GetHookClient(info.Env());
+	client.delivery.Clear();
+
+	client.engine.Clear();
+	client.Update();
+
+	return info.Env().Undefined();
+}
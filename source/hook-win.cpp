@@ -18,103 +18,226 @@
 
 #include "hook.h"
 
+#include "hook-client.h"
+#include "key-names.h"
+
 #include <thread>
-#include <mutex>
+#include <future>
 #include <iostream>
-#include <sstream>
 #include <inttypes.h>
 #include <vector>
-#include <map>
 #include <windows.h>
 
-class Worker : public Napi::AsyncWorker {
-public:
-	Worker(Napi::Function &callback) : AsyncWorker(callback){};
-	virtual ~Worker(){};
-
-	void Execute(){};
-	void OnOK() { Callback().Call({}); };
-};
-
 typedef int16_t key_t;
 
-struct HotKey {
-	std::vector<std::pair<key_t, bool>> keys;
-	std::unique_ptr<Worker> cbDown, cbUp;
-	bool wasDown = false;
+// Feeds key and mouse button transitions from low level hooks. The hook thread
+// sleeps in MsgWaitForMultipleObjectsEx and only wakes when the OS delivers
+// input, or when the timer sink asked for it.
+class LowLevelHookSource : public KeyEventSource {
+public:
+	bool Start(Sink sink) override;
+	void Stop() override;
+	void Wake() override;
+
+private:
+	static LRESULT CALLBACK KeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+	static LRESULT CALLBACK MouseProc(int nCode, WPARAM wParam, LPARAM lParam);
 
-	static uint32_t Stringify(std::vector<std::pair<key_t, bool>> keys)
+	void Run(std::promise<bool> ready);
+	// True if the event is swallowed.
+	bool Emit(key_t vk, bool down)
 	{
-		std::ostringstream os;
-		for (size_t idx = 0; idx < keys.size(); idx++) {
-			os << keys[idx].first << ":" << keys[idx].second << "|";
-		}
-		std::string outString = os.str();
-		return std::hash<std::string>{}(outString);
+		if (m_keyFilter)
+			return m_keyFilter({(keycode_t)vk, down});
+		m_sink({(keycode_t)vk, down});
+		return false;
 	};
-};
+	void EmitInput(InputType type, uint16_t code, int32_t x, int32_t y)
+	{
+		if (m_inputSink)
+			m_inputSink({type, 0, code, x, y, 0});
+	};
+	bool EmitButton(key_t vk, uint16_t button, bool down, POINT pt);
+	void EmitWheel(int32_t &remainder, short delta, bool horizontal);
+
+	static LowLevelHookSource *s_active;
 
-struct ThreadData {
-	std::mutex mtx;
-	std::thread worker;
-	std::map<uint32_t, HotKey> hotkeys;
+	Sink m_sink;
+	std::thread m_thread;
+	DWORD m_threadId = 0;
+
+	// Hook thread only.
+	uint32_t m_buttonsHeld = 0;
+	int32_t m_wheelX = 0, m_wheelY = 0;
+};
 
-	bool shutdown = false;
-} gThreadData;
+LowLevelHookSource *LowLevelHookSource::s_active = nullptr;
 
-static bool isKeyDown(key_t k)
+// Low level hooks only report the sided modifiers, the generic codes are
+// held while either side is.
+KeyState PlatformKeyState()
 {
-	return (bool)(GetAsyncKeyState(k) >> 15);
+	return KeyState({
+		{VK_SHIFT, MOD_SHIFT, true},
+		{VK_LSHIFT, MOD_SHIFT, false},
+		{VK_RSHIFT, MOD_SHIFT, false},
+		{VK_CONTROL, MOD_CTRL, true},
+		{VK_LCONTROL, MOD_CTRL, false},
+		{VK_RCONTROL, MOD_CTRL, false},
+		{VK_MENU, MOD_ALT, true},
+		{VK_LMENU, MOD_ALT, false},
+		{VK_RMENU, MOD_ALT, false},
+		{VK_LWIN, MOD_META, false},
+	});
 }
 
-static int32_t HotKeyThread(void *arg)
+static LowLevelHookSource g_source;
+
+bool LowLevelHookSource::Start(Sink sink)
 {
-	ThreadData *td = static_cast<ThreadData *>(arg);
+	m_sink = std::move(sink);
 
-	// Temporarily prevent execution until main is ready.
-	{
-		std::unique_lock<std::mutex> ulock(td->mtx);
+	std::promise<bool> ready;
+	std::future<bool> started = ready.get_future();
+	m_thread = std::thread(&LowLevelHookSource::Run, this, std::move(ready));
+
+	if (!started.get()) {
+		m_thread.join();
+		return false;
 	}
+	return true;
+}
 
-	while (!td->shutdown) {
-		// Test each hotkey
-		{
-			std::unique_lock<std::mutex> ulock(td->mtx);
-			for (auto &hk : td->hotkeys) {
-				bool allPressed = true;
-
-				for (std::pair<key_t, bool> k : hk.second.keys) {
-					bool isBound = k.second;
-					bool isPressed = isKeyDown(k.first);
-
-					if (isBound && !isPressed) {
-						allPressed = false;
-					} else if (!isBound && isPressed) {
-						if (!hk.second.wasDown) {
-							allPressed = false;
-						}
-					}
-				}
-
-				if (allPressed && !hk.second.wasDown) {
-					if (hk.second.cbDown != nullptr)
-						hk.second.cbDown->Queue();
-
-					hk.second.wasDown = true;
-				} else if (!allPressed && hk.second.wasDown) {
-					if (hk.second.cbUp != nullptr)
-						hk.second.cbUp->Queue();
-
-					hk.second.wasDown = false;
-				}
-			}
+void LowLevelHookSource::Stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	PostThreadMessage(m_threadId, WM_QUIT, 0, 0);
+	m_thread.join();
+}
+
+void LowLevelHookSource::Wake()
+{
+	if (m_thread.joinable())
+		PostThreadMessage(m_threadId, WM_NULL, 0, 0);
+}
+
+void LowLevelHookSource::Run(std::promise<bool> ready)
+{
+	m_threadId = GetCurrentThreadId();
+
+	// Force creation of the message queue so Stop() can post to it.
+	MSG msg;
+	PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+	s_active = this;
+	HHOOK keyboard = SetWindowsHookEx(WH_KEYBOARD_LL, KeyboardProc, GetModuleHandle(NULL), 0);
+	HHOOK mouse = SetWindowsHookEx(WH_MOUSE_LL, MouseProc, GetModuleHandle(NULL), 0);
+
+	if (keyboard == NULL || mouse == NULL) {
+		if (keyboard != NULL)
+			UnhookWindowsHookEx(keyboard);
+		if (mouse != NULL)
+			UnhookWindowsHookEx(mouse);
+		s_active = nullptr;
+		ready.set_value(false);
+		return;
+	}
+	ready.set_value(true);
+
+	// The hook procedures are called from PeekMessage.
+	bool quit = false;
+	while (!quit) {
+		int32_t wait = m_timerSink ? m_timerSink() : -1;
+		if (MsgWaitForMultipleObjectsEx(0, NULL, wait < 0 ? INFINITE : (DWORD)wait, QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_FAILED)
+			break;
+
+		while (!quit && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			quit = msg.message == WM_QUIT;
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
 		}
+	}
+
+	UnhookWindowsHookEx(keyboard);
+	UnhookWindowsHookEx(mouse);
+	s_active = nullptr;
+}
 
-		// Sleep 1ms (at most). Actual time varies, no hardware or scheduler is perfect.
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+LRESULT CALLBACK LowLevelHookSource::KeyboardProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+	if (nCode == HC_ACTION && s_active) {
+		KBDLLHOOKSTRUCT *kb = reinterpret_cast<KBDLLHOOKSTRUCT *>(lParam);
+		bool down = wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN;
+		s_active->EmitInput(down ? InputType::KeyDown : InputType::KeyUp, (uint16_t)kb->vkCode, 0, 0);
+		// Nonzero keeps the event from the rest of the hook chain and the
+		// focused window.
+		if (s_active->Emit((key_t)kb->vkCode, down))
+			return 1;
 	}
+	return CallNextHookEx(NULL, nCode, wParam, lParam);
+}
+
+bool LowLevelHookSource::EmitButton(key_t vk, uint16_t button, bool down, POINT pt)
+{
+	uint32_t bit = 1u << button;
+	m_buttonsHeld = down ? m_buttonsHeld | bit : m_buttonsHeld & ~bit;
+	EmitInput(down ? InputType::MousePressed : InputType::MouseReleased, button, pt.x, pt.y);
+	return Emit(vk, down);
+}
 
-	return 0;
+void LowLevelHookSource::EmitWheel(int32_t &remainder, short delta, bool horizontal)
+{
+	// Reported in notches like the other platforms, high resolution wheels
+	// add up until they make one.
+	remainder += delta;
+	int32_t notches = remainder / WHEEL_DELTA;
+	if (notches == 0)
+		return;
+	remainder -= notches * WHEEL_DELTA;
+	EmitInput(InputType::MouseWheel, 0, horizontal ? notches : 0, horizontal ? 0 : notches);
+}
+
+LRESULT CALLBACK LowLevelHookSource::MouseProc(int nCode, WPARAM wParam, LPARAM lParam)
+{
+	if (nCode == HC_ACTION && s_active) {
+		MSLLHOOKSTRUCT *ms = reinterpret_cast<MSLLHOOKSTRUCT *>(lParam);
+		bool consume = false;
+		switch (wParam) {
+		case WM_LBUTTONDOWN:
+		case WM_LBUTTONUP:
+			consume = s_active->EmitButton(VK_LBUTTON, 1, wParam == WM_LBUTTONDOWN, ms->pt);
+			break;
+		case WM_RBUTTONDOWN:
+		case WM_RBUTTONUP:
+			consume = s_active->EmitButton(VK_RBUTTON, 2, wParam == WM_RBUTTONDOWN, ms->pt);
+			break;
+		case WM_MBUTTONDOWN:
+		case WM_MBUTTONUP:
+			consume = s_active->EmitButton(VK_MBUTTON, 3, wParam == WM_MBUTTONDOWN, ms->pt);
+			break;
+		case WM_XBUTTONDOWN:
+		case WM_XBUTTONUP:
+			if (HIWORD(ms->mouseData) == XBUTTON1)
+				consume = s_active->EmitButton(VK_XBUTTON1, 4, wParam == WM_XBUTTONDOWN, ms->pt);
+			else
+				consume = s_active->EmitButton(VK_XBUTTON2, 5, wParam == WM_XBUTTONDOWN, ms->pt);
+			break;
+		case WM_MOUSEMOVE:
+			s_active->EmitInput(s_active->m_buttonsHeld ? InputType::MouseDragged : InputType::MouseMoved, 0, ms->pt.x, ms->pt.y);
+			break;
+		case WM_MOUSEWHEEL:
+			s_active->EmitWheel(s_active->m_wheelY, (short)HIWORD(ms->mouseData), false);
+			break;
+		case WM_MOUSEHWHEEL:
+			s_active->EmitWheel(s_active->m_wheelX, (short)HIWORD(ms->mouseData), true);
+			break;
+		}
+		if (consume)
+			return 1;
+	}
+	return CallNextHookEx(NULL, nCode, wParam, lParam);
 }
 
 template<class ContainerT> void tokenize(const std::string &str, ContainerT &tokens, const std::string &delimiters = " ", bool trimEmpty = false)
@@ -137,266 +260,31 @@ template<class ContainerT> void tokenize(const std::string &str, ContainerT &tok
 	}
 }
 
-Napi::Value StartHotkeyThreadJS(const Napi::CallbackInfo &info)
+// Hotkeys go from the hook thread straight to the JS threads, without a lock
+// or a round trip through the libuv threadpool.
+bool StartCapture()
 {
-	if (gThreadData.worker.joinable())
-		return Napi::Boolean::New(info.Env(), false);
-
-	gThreadData.mtx.lock();
-	gThreadData.worker = std::thread(HotKeyThread, &gThreadData);
-	gThreadData.mtx.unlock();
-
-	return Napi::Boolean::New(info.Env(), true);
+	g_source.SetInputSink([](const InputEvent &event) { GetCaptureHub().OnInput(event); });
+	g_source.SetTimerSink([]() { return GetCaptureHub().OnTimer(); });
+	g_source.SetKeyFilter([](const KeyEvent &event) { return GetCaptureHub().OnKeyEvent(event); });
+	return g_source.Start([](const KeyEvent &event) { GetCaptureHub().OnKeyEvent(event); });
 }
 
-Napi::Value StopHotkeyThreadJS(const Napi::CallbackInfo &info)
+void StopCapture()
 {
-	if (!gThreadData.worker.joinable())
-		return Napi::Boolean::New(info.Env(), false);
-
-	gThreadData.shutdown = true;
-	gThreadData.worker.join();
+	g_source.Stop();
+}
 
-	return Napi::Boolean::New(info.Env(), true);
+void WakeCapture()
+{
+	g_source.Wake();
 }
 
-std::vector<std::pair<key_t, bool>> StringToKeys(std::string keystr, Napi::Object modifiers)
+bool StringToChord(const std::string &keystr, Napi::Object modifiers, Chord &chord)
 {
-	static std::map<std::string, key_t> g_KeyMap = {
-#ifdef _WIN32
-		// Mouse
-		std::make_pair("LeftMouseButton", VK_LBUTTON),
-		std::make_pair("RightMouseButton", VK_RBUTTON),
-		std::make_pair("MiddleMouseButton", VK_MBUTTON),
-		std::make_pair("X1MouseButton", VK_XBUTTON1),
-		std::make_pair("X2MouseButton", VK_XBUTTON2),
-		// Keyboard
-		std::make_pair("Backspace", VK_BACK),
-		std::make_pair("Tab", VK_TAB),
-		std::make_pair("Clear", VK_CLEAR),
-		std::make_pair("Enter", VK_RETURN),
-		std::make_pair("Shift", VK_SHIFT),
-		std::make_pair("ShiftLeft", VK_LSHIFT),
-		std::make_pair("ShiftRight", VK_RSHIFT),
-		std::make_pair("Control", VK_CONTROL),
-		std::make_pair("ControlLeft", VK_LCONTROL),
-		std::make_pair("ControlRight", VK_RCONTROL),
-		std::make_pair("Command", VK_CONTROL),
-		std::make_pair("LeftCommand", VK_LCONTROL),
-		std::make_pair("RightCommand", VK_RCONTROL),
-		std::make_pair("CommandOrControl", VK_CONTROL),
-		std::make_pair("LeftCommandOrControl", VK_LCONTROL),
-		std::make_pair("RightCommandOrControl", VK_RCONTROL),
-		std::make_pair("Alt", VK_MENU),
-		std::make_pair("AltLeft", VK_LMENU),
-		std::make_pair("AltRight", VK_RMENU),
-		std::make_pair("Menu", VK_MENU),
-		std::make_pair("LeftMenu", VK_LMENU),
-		std::make_pair("RightMenu", VK_RMENU),
-		std::make_pair("OSLeft", VK_LWIN),
-		std::make_pair("OSRight", VK_RWIN),
-		std::make_pair("Pause", VK_PAUSE),
-		std::make_pair("Capital", VK_CAPITAL),
-		std::make_pair("CapsLock", VK_CAPITAL),
-		std::make_pair("NumLock", VK_NUMLOCK),
-		std::make_pair("ScrollLock", VK_SCROLL),
-		std::make_pair("Escape", VK_ESCAPE),
-		std::make_pair("Space", VK_SPACE),
-		std::make_pair("PageUp", VK_PRIOR),
-		std::make_pair("PageDown", VK_NEXT),
-		std::make_pair("Home", VK_HOME),
-		std::make_pair("End", VK_END),
-		std::make_pair("Left", VK_LEFT),
-		std::make_pair("Right", VK_RIGHT),
-		std::make_pair("Up", VK_UP),
-		std::make_pair("Down", VK_DOWN),
-		std::make_pair("Select", VK_SELECT),
-		std::make_pair("Print", VK_PRINT),
-		std::make_pair("Execute", VK_EXECUTE),
-		std::make_pair("Snapshot", VK_SNAPSHOT),
-		std::make_pair("PrintScreen", VK_SNAPSHOT),
-		std::make_pair("Insert", VK_INSERT),
-		std::make_pair("Delete", VK_DELETE),
-		std::make_pair("Help", VK_HELP),
-		std::make_pair("Apps", VK_APPS),
-		std::make_pair("Sleep", VK_SLEEP),
-		/// Function
-		std::make_pair("F1", VK_F1),
-		std::make_pair("F2", VK_F2),
-		std::make_pair("F3", VK_F3),
-		std::make_pair("F4", VK_F4),
-		std::make_pair("F5", VK_F5),
-		std::make_pair("F6", VK_F6),
-		std::make_pair("F7", VK_F7),
-		std::make_pair("F8", VK_F8),
-		std::make_pair("F9", VK_F9),
-		std::make_pair("F10", VK_F10),
-		std::make_pair("F11", VK_F11),
-		std::make_pair("F12", VK_F12),
-		std::make_pair("F13", VK_F13),
-		std::make_pair("F14", VK_F14),
-		std::make_pair("F15", VK_F15),
-		std::make_pair("F16", VK_F16),
-		std::make_pair("F17", VK_F17),
-		std::make_pair("F18", VK_F18),
-		std::make_pair("F19", VK_F19),
-		std::make_pair("F20", VK_F20),
-		std::make_pair("F21", VK_F21),
-		std::make_pair("F22", VK_F22),
-		std::make_pair("F23", VK_F23),
-		std::make_pair("F24", VK_F24),
-		/// Numeric
-		std::make_pair("Digit0", 0x30),
-		std::make_pair("Digit1", 0x31),
-		std::make_pair("Digit2", 0x32),
-		std::make_pair("Digit3", 0x33),
-		std::make_pair("Digit4", 0x34),
-		std::make_pair("Digit5", 0x35),
-		std::make_pair("Digit6", 0x36),
-		std::make_pair("Digit7", 0x37),
-		std::make_pair("Digit8", 0x38),
-		std::make_pair("Digit9", 0x39),
-		/// Letters
-		std::make_pair("KeyA", 0x41),
-		std::make_pair("KeyB", 0x42),
-		std::make_pair("KeyC", 0x43),
-		std::make_pair("KeyD", 0x44),
-		std::make_pair("KeyE", 0x45),
-		std::make_pair("KeyF", 0x46),
-		std::make_pair("KeyG", 0x47),
-		std::make_pair("KeyH", 0x48),
-		std::make_pair("KeyI", 0x49),
-		std::make_pair("KeyJ", 0x4A),
-		std::make_pair("KeyK", 0x4B),
-		std::make_pair("KeyL", 0x4C),
-		std::make_pair("KeyM", 0x4D),
-		std::make_pair("KeyN", 0x4E),
-		std::make_pair("KeyO", 0x4F),
-		std::make_pair("KeyP", 0x50),
-		std::make_pair("KeyQ", 0x51),
-		std::make_pair("KeyR", 0x52),
-		std::make_pair("KeyS", 0x53),
-		std::make_pair("KeyT", 0x54),
-		std::make_pair("KeyU", 0x55),
-		std::make_pair("KeyV", 0x56),
-		std::make_pair("KeyW", 0x57),
-		std::make_pair("KeyX", 0x58),
-		std::make_pair("KeyY", 0x59),
-		std::make_pair("KeyZ", 0x5A),
-		/// Numeric Pad
-		std::make_pair("Numpad0", VK_NUMPAD0),
-		std::make_pair("Numpad1", VK_NUMPAD1),
-		std::make_pair("Numpad2", VK_NUMPAD2),
-		std::make_pair("Numpad3", VK_NUMPAD3),
-		std::make_pair("Numpad4", VK_NUMPAD4),
-		std::make_pair("Numpad5", VK_NUMPAD5),
-		std::make_pair("Numpad6", VK_NUMPAD6),
-		std::make_pair("Numpad7", VK_NUMPAD7),
-		std::make_pair("Numpad8", VK_NUMPAD8),
-		std::make_pair("Numpad9", VK_NUMPAD9),
-		std::make_pair("NumpadMultiply", VK_MULTIPLY),
-		std::make_pair("NumpadDivide", VK_DIVIDE),
-		std::make_pair("NumpadAdd", VK_ADD),
-		std::make_pair("NumpadSubtract", VK_SUBTRACT),
-		std::make_pair("Separator", VK_SEPARATOR),
-		std::make_pair("NumpadDecimal", VK_DECIMAL),
-		std::make_pair("NumLock", VK_NUMLOCK),
-		std::make_pair("NumpadEnter", VK_RETURN),
-
-		/// OEM Keys
-		std::make_pair("Semicolon", VK_OEM_1),
-		std::make_pair("Equal", VK_OEM_PLUS),
-		std::make_pair("Comma", VK_OEM_COMMA),
-		std::make_pair("Minus", VK_OEM_MINUS),
-		std::make_pair("Period", VK_OEM_PERIOD),
-		std::make_pair("Slash", VK_OEM_2),
-		std::make_pair("Backquote", VK_OEM_3),
-		std::make_pair("BracketLeft", VK_OEM_4),
-		std::make_pair("Backslash", VK_OEM_5),
-		std::make_pair("BracketRight", VK_OEM_6),
-		std::make_pair("Quote", VK_OEM_7),
-		// Arrows
-		std::make_pair("ArrowUp", VK_UP),
-		std::make_pair("ArrowLeft", VK_LEFT),
-		std::make_pair("ArrowRight", VK_RIGHT),
-		std::make_pair("ArrowDown", VK_DOWN),
-
-		/// Media
-		std::make_pair("MediaPlayPause", VK_MEDIA_PLAY_PAUSE),
-		std::make_pair("MediaTrackPrevious", VK_MEDIA_PREV_TRACK),
-		std::make_pair("MediaTrackNext", VK_MEDIA_NEXT_TRACK),
-		std::make_pair("MediaStop", VK_MEDIA_STOP),
-#else
-		std::make_pair("Escape", VC_ESCAPE),
-		std::make_pair("F1", VC_F1),
-		std::make_pair("F2", VC_F2),
-		std::make_pair("F3", VC_F3),
-		std::make_pair("F4", VC_F4),
-		std::make_pair("F5", VC_F5),
-		std::make_pair("F6", VC_F6),
-		std::make_pair("F7", VC_F7),
-		std::make_pair("F8", VC_F8),
-		std::make_pair("F9", VC_F9),
-		std::make_pair("F10", VC_F10),
-		std::make_pair("F11", VC_F11),
-		std::make_pair("F12", VC_F12),
-		std::make_pair("F13", VC_F13),
-		std::make_pair("F14", VC_F14),
-		std::make_pair("F15", VC_F15),
-		std::make_pair("F16", VC_F16),
-		std::make_pair("F17", VC_F17),
-		std::make_pair("F18", VC_F18),
-		std::make_pair("F19", VC_F19),
-		std::make_pair("F20", VC_F20),
-		std::make_pair("F21", VC_F21),
-		std::make_pair("F22", VC_F22),
-		std::make_pair("F23", VC_F23),
-		std::make_pair("F24", VC_F24),
-		std::make_pair("1", VC_1),
-		std::make_pair("2", VC_2),
-		std::make_pair("3", VC_3),
-		std::make_pair("4", VC_4),
-		std::make_pair("5", VC_5),
-		std::make_pair("6", VC_6),
-		std::make_pair("7", VC_7),
-		std::make_pair("8", VC_8),
-		std::make_pair("9", VC_9),
-		std::make_pair("0", VC_0),
-		std::make_pair("Backspace", VC_BACKSPACE),
-		std::make_pair("Tab", VC_TAB),
-		std::make_pair("A", VC_A),
-		std::make_pair("B", VC_B),
-		std::make_pair("C", VC_C),
-		std::make_pair("D", VC_D),
-		std::make_pair("E", VC_E),
-		std::make_pair("F", VC_F),
-		std::make_pair("G", VC_G),
-		std::make_pair("H", VC_H),
-		std::make_pair("I", VC_I),
-		std::make_pair("J", VC_J),
-		std::make_pair("K", VC_K),
-		std::make_pair("L", VC_L),
-		std::make_pair("M", VC_M),
-		std::make_pair("N", VC_N),
-		std::make_pair("O", VC_O),
-		std::make_pair("P", VC_P),
-		std::make_pair("Q", VC_Q),
-		std::make_pair("R", VC_R),
-		std::make_pair("S", VC_S),
-		std::make_pair("T", VC_T),
-		std::make_pair("U", VC_U),
-		std::make_pair("V", VC_V),
-		std::make_pair("W", VC_W),
-		std::make_pair("X", VC_X),
-		std::make_pair("Y", VC_Y),
-		std::make_pair("Z", VC_Z),
-		std::make_pair("Control", 29),
-		std::make_pair("CommandOrControl", 29),
-		std::make_pair("Command", 29),
-		std::make_pair("Alt", 56),
-		std::make_pair("Shift", 42),
-#endif
-	};
+	keycode_t key;
+	if (!g_KeyNames.Find(keystr, key))
+		return false;
 
 	bool modShift, modCtrl, modMenu, modMeta;
 	modShift = modifiers.Get("shift").ToBoolean().Value();
@@ -404,22 +292,10 @@ std::vector<std::pair<key_t, bool>> StringToKeys(std::string keystr, Napi::Objec
 	modMenu = modifiers.Get("alt").ToBoolean().Value();
 	modMeta = modifiers.Get("meta").ToBoolean().Value();
 
-	std::map<std::string, key_t>::iterator it = g_KeyMap.find(keystr);
-
-	std::vector<std::pair<key_t, bool>> keys;
-
-	if (it != g_KeyMap.end()) {
-		key_t key = g_KeyMap.at(keystr);
-
-		keys.push_back(std::make_pair(g_KeyMap.at("Shift"), modShift));
-		keys.push_back(std::make_pair(g_KeyMap.at("Control"), modCtrl));
-		keys.push_back(std::make_pair(g_KeyMap.at("Menu"), modMenu));
-		keys.push_back(std::make_pair(g_KeyMap.at("OSLeft"), modMeta));
-
-		keys.push_back(std::make_pair(key, true));
-	}
-
-	return std::move(keys);
+	chord.key = key;
+	chord.modifiers = (modShift ? MOD_SHIFT : 0) | (modCtrl ? MOD_CTRL : 0) | (modMenu ? MOD_ALT : 0) | (modMeta ? MOD_META : 0);
+	chord.care = MOD_ALL;
+	return true;
 }
 
 Napi::Value RegisterHotkeyJS(const Napi::CallbackInfo &info)
@@ -434,105 +310,65 @@ Napi::Value RegisterHotkeyJS(const Napi::CallbackInfo &info)
 	 *     shift: boolean;
 	 *     meta: boolean;
 	 *   };
+	 *   consume?: boolean; // keep the key from the focused application
 	 * }
 	 */
+	HookClient &client = GetHookClient(info.Env());
 
 	Napi::Object binds = info[0].ToObject();
-	std::vector<std::pair<key_t, bool>> keys = StringToKeys(binds.Get("key").ToString().Utf8Value(), binds.Get("modifiers").ToObject());
 	std::string eventString = binds.Get("eventType").ToString().Utf8Value();
 
-	if (keys.size() == 0)
+	Chord chord;
+	if (!StringToChord(binds.Get("key").ToString().Utf8Value(), binds.Get("modifiers").ToObject(), chord))
 		return Napi::Boolean::New(info.Env(), false);
 
-	uint32_t key = HotKey::Stringify(keys);
-	if (gThreadData.hotkeys.count(key)) {
-		auto hk = gThreadData.hotkeys.find(key);
-
-		// Lock mutex for modifications
-
-		if (eventString == "registerKeydown") {
-			if (!hk->second.cbDown) {
-				// Lock mutex for modifications
-				std::unique_lock<std::mutex> ulock(gThreadData.mtx);
-				hk->second.cbDown = std::make_unique<Worker>(binds.Get("callback").As<Napi::Function>());
-				hk->second.cbDown->SuppressDestruct();
-			} else {
-				return Napi::Boolean::New(info.Env(), false);
-			}
-		} else if (eventString == "registerKeyup") {
-			if (!hk->second.cbUp) {
-				// Lock mutex for modifications
-				std::unique_lock<std::mutex> ulock(gThreadData.mtx);
-				hk->second.cbUp = std::make_unique<Worker>(binds.Get("callback").As<Napi::Function>());
-				hk->second.cbUp->SuppressDestruct();
-			} else {
-				return Napi::Boolean::New(info.Env(), false);
-			}
-		}
-	} else {
-		HotKey hk;
-		hk.keys = std::move(keys);
-		hk.wasDown = false;
-
-		if (eventString == "registerKeydown") {
-			hk.cbDown = std::make_unique<Worker>(binds.Get("callback").As<Napi::Function>());
-			hk.cbDown->SuppressDestruct();
-		} else if (eventString == "registerKeyup") {
-			hk.cbUp = std::make_unique<Worker>(binds.Get("callback").As<Napi::Function>());
-			hk.cbUp->SuppressDestruct();
-		}
+	if (eventString != "registerKeydown" && eventString != "registerKeyup")
+		return Napi::Boolean::New(info.Env(), false);
 
-		// Lock mutex for modifications
-		std::unique_lock<std::mutex> ulock(gThreadData.mtx);
-		gThreadData.hotkeys.insert_or_assign(key, std::move(hk));
-	}
+	ChordId key = MakeChordId(chord);
+	KeyEdge edge = eventString == "registerKeydown" ? KeyEdge::Pressed : KeyEdge::Released;
+	if (!client.delivery.SetCallback(key, edge, binds.Get("callback").As<Napi::Function>()))
+		return Napi::Boolean::New(info.Env(), false);
+
+	// consume sticks to the chord once any of its callbacks asked for it.
+	bool consume = binds.Get("consume").ToBoolean().Value() || client.engine.Consumes(key);
+	client.engine.SetHotkey(key, chord, consume);
+	client.Update();
 
 	return Napi::Boolean::New(info.Env(), true);
 }
 
 Napi::Value UnregisterHotkeyJS(const Napi::CallbackInfo &info)
 {
+	HookClient &client = GetHookClient(info.Env());
 	Napi::Object binds = info[0].ToObject();
-	std::vector<std::pair<key_t, bool>> keys = StringToKeys(binds.Get("key").ToString().Utf8Value(), binds.Get("modifiers").ToObject());
 	std::string eventString = binds.Get("eventType").ToString().Utf8Value();
 
-	if (keys.size() == 0)
+	Chord chord;
+	if (!StringToChord(binds.Get("key").ToString().Utf8Value(), binds.Get("modifiers").ToObject(), chord))
 		return Napi::Boolean::New(info.Env(), false);
 
-	uint32_t key = HotKey::Stringify(keys);
-	if (!gThreadData.hotkeys.count(key)) {
+	ChordId key = MakeChordId(chord);
+	KeyEdge edge = eventString == "registerKeydown" ? KeyEdge::Pressed : KeyEdge::Released;
+	if (!client.delivery.RemoveCallback(key, edge)) {
 		std::cout << "Cannot find key " << key << std::endl;
 		return Napi::Boolean::New(info.Env(), false);
 	}
-	// Lock mutex for modifications
-	std::unique_lock<std::mutex> ulock(gThreadData.mtx);
-
-	auto hk = gThreadData.hotkeys.find(key);
 
-	if (eventString == "registerKeydown") {
-		if (hk->second.cbDown) {
-			hk->second.cbDown = nullptr;
-		} else {
-			return Napi::Boolean::New(info.Env(), false);
-		}
-	} else if (eventString == "registerKeyup") {
-		if (hk->second.cbUp) {
-			hk->second.cbUp = nullptr;
-		} else {
-			return Napi::Boolean::New(info.Env(), false);
-		}
-	}
-	// If both callbacks were removed, don't bother keeping the object around.
-	if ((hk->second.cbUp == nullptr) && (hk->second.cbDown == nullptr)) {
-		gThreadData.hotkeys.erase(key);
-	}
+	// If both callbacks were removed, stop matching the chord.
+	if (!client.delivery.HasCallbacks(key))
+		client.engine.RemoveHotkey(key);
+	client.Update();
 	return Napi::Boolean::New(info.Env(), true);
 }
 
 Napi::Value UnregisterHotkeysJS(const Napi::CallbackInfo &info)
 {
-	std::unique_lock<std::mutex> ulock(gThreadData.mtx);
-	gThreadData.hotkeys.clear();
+	HookClient &client = GetHookClient(info.Env());
+	client.delivery.Clear();
+
+	client.engine.Clear();
+	client.Update();
 
 	return info.Env().Undefined();
-}
\ No newline at end of file
+}
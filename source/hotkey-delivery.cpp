@@ -0,0 +1,415 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "hotkey-delivery.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+static uint32_t NowMs()
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t NowNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void HotkeyDelivery::Start(Napi::Env env)
+{
+	if (m_ring)
+		m_dropped += m_ring->Dropped();
+	m_ring.reset(new SpscRing<HotkeyEvent>(m_options.size, m_options.overflow));
+
+	m_wakePending = false;
+	m_wake = Napi::ThreadSafeFunction::New(env, Napi::Function::New(env, [](const Napi::CallbackInfo &) {}), "HotkeyDelivery", 0, 1);
+}
+
+void HotkeyDelivery::Stop()
+{
+	// A wake-up that is already queued still runs and drains the ring.
+	if (m_wake) {
+		m_wake.Release();
+		m_wake = Napi::ThreadSafeFunction();
+	}
+}
+
+bool HotkeyDelivery::SetCallback(ChordId id, KeyEdge edge, Napi::Function callback)
+{
+	Callbacks &cbs = m_callbacks[id];
+	Napi::FunctionReference &cb = edge == KeyEdge::Pressed ? cbs.down : cbs.up;
+	if (!cb.IsEmpty())
+		return false;
+
+	cb = Napi::Persistent(callback);
+	return true;
+}
+
+bool HotkeyDelivery::RemoveCallback(ChordId id, KeyEdge edge)
+{
+	Callbacks *cbs = m_callbacks.Find(id);
+	if (!cbs)
+		return false;
+
+	Napi::FunctionReference &cb = edge == KeyEdge::Pressed ? cbs->down : cbs->up;
+	if (cb.IsEmpty())
+		return false;
+
+	cb.Reset();
+	if (cbs->down.IsEmpty() && cbs->up.IsEmpty())
+		m_callbacks.Erase(id);
+	return true;
+}
+
+bool HotkeyDelivery::HasCallbacks(ChordId id) const
+{
+	return m_callbacks.Find(id) != nullptr;
+}
+
+bool HotkeyDelivery::HasCallback(ChordId id, KeyEdge edge) const
+{
+	const Callbacks *cbs = m_callbacks.Find(id);
+	return cbs && !(edge == KeyEdge::Pressed ? cbs->down : cbs->up).IsEmpty();
+}
+
+void HotkeyDelivery::Clear()
+{
+	m_callbacks.Clear();
+}
+
+void HotkeyDelivery::SetBatchCallback(Napi::Function callback)
+{
+	if (callback.IsEmpty())
+		m_batchCallback.Reset();
+	else
+		m_batchCallback = Napi::Persistent(callback);
+}
+
+void HotkeyDelivery::Captured()
+{
+	m_captured = NowNs();
+	m_stats.events.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HotkeyDelivery::Ticked()
+{
+	m_captured = NowNs();
+}
+
+void HotkeyDelivery::Push(ChordId id, KeyEdge edge)
+{
+	uint64_t matched = NowNs();
+	m_ring->Push({id, (uint32_t)edge, NowMs(), m_captured});
+	uint64_t enqueued = NowNs();
+	Wake();
+
+	m_stats.matched.fetch_add(1, std::memory_order_relaxed);
+	if (m_captured) {
+		m_stats.match.Record(matched - m_captured);
+		m_stats.enqueue.Record(enqueued - m_captured);
+	}
+	uint64_t depth = m_ring->Size();
+	if (depth > m_stats.maxQueueDepth.load(std::memory_order_relaxed))
+		m_stats.maxQueueDepth.store(depth, std::memory_order_relaxed);
+}
+
+void HotkeyDelivery::Wake()
+{
+	if (!m_wakePending.exchange(true, std::memory_order_acq_rel))
+		m_wake.NonBlockingCall([this](Napi::Env env, Napi::Function) { Drain(env); });
+}
+
+void HotkeyDelivery::Drain(Napi::Env env)
+{
+	// Cleared first, so events pushed from here on schedule a new wake-up.
+	m_wakePending.store(false, std::memory_order_release);
+
+	if (!m_batchCallback.IsEmpty()) {
+		DrainBatch(env);
+		return;
+	}
+
+	HotkeyEvent event;
+	while (m_ring && m_ring->Pop(event)) {
+		Callbacks *cbs = m_callbacks.Find(event.id);
+		if (!cbs)
+			continue;
+
+		// Callbacks may register or unregister hotkeys, so cbs is not used
+		// after the call.
+		Napi::FunctionReference &cb = event.edge == (uint32_t)KeyEdge::Pressed ? cbs->down : cbs->up;
+		if (cb.IsEmpty())
+			continue;
+
+		if (event.captured)
+			m_stats.js.Record(NowNs() - event.captured);
+		try {
+			cb.Call({});
+		} catch (...) {
+			// Let the exception surface, the rest is delivered on the next turn.
+			if (m_wake)
+				Wake();
+			throw;
+		}
+	}
+}
+
+void HotkeyDelivery::DrainBatch(Napi::Env env)
+{
+	// Take at most one ring's worth, so a producer that keeps up with the
+	// drain can't hold the JS thread here.
+	m_batch.clear();
+	m_batchCaptured.clear();
+	HotkeyEvent event;
+	for (size_t n = m_ring ? m_ring->Capacity() : 0; n > 0 && m_ring->Pop(event); n--) {
+		const Callbacks *cbs = m_callbacks.Find(event.id);
+		if (!cbs || (event.edge == (uint32_t)KeyEdge::Pressed ? cbs->down : cbs->up).IsEmpty())
+			continue;
+
+		m_batch.push_back((uint32_t)event.id);
+		m_batch.push_back(event.edge);
+		m_batch.push_back(event.time);
+		if (event.captured)
+			m_batchCaptured.push_back(event.captured);
+	}
+	if (m_ring && m_ring->Size() > 0 && m_wake)
+		Wake();
+
+	if (m_batch.empty())
+		return;
+
+	// Every record reaches JS with this one call.
+	uint64_t now = NowNs();
+	for (uint64_t captured : m_batchCaptured)
+		m_stats.js.Record(now - captured);
+
+	Napi::Uint32Array records = Napi::Uint32Array::New(env, m_batch.size());
+	memcpy(records.Data(), m_batch.data(), m_batch.size() * sizeof(uint32_t));
+	m_batchCallback.Call({records});
+}
+
+bool ParseSequenceSteps(Napi::Object binds, ChordParser parse, std::vector<SequenceTrie::Step> &steps)
+{
+	uint32_t timeout = 1000;
+	if (binds.Has("timeout"))
+		timeout = binds.Get("timeout").ToNumber().Uint32Value();
+
+	Napi::Value value = binds.Get("steps");
+	if (!value.IsArray())
+		return false;
+
+	Napi::Array array = value.As<Napi::Array>();
+	for (uint32_t i = 0; i < array.Length(); i++) {
+		Napi::Object step = array.Get(i).ToObject();
+		Chord chord;
+		Napi::Object modifiers = step.Has("modifiers") ? step.Get("modifiers").ToObject() : Napi::Object::New(binds.Env());
+		if (!parse(step.Get("key").ToString().Utf8Value(), modifiers, chord))
+			return false;
+		uint32_t stepTimeout = step.Has("timeout") ? step.Get("timeout").ToNumber().Uint32Value() : timeout;
+		steps.push_back({MakeChordId(chord), stepTimeout});
+	}
+	return !steps.empty();
+}
+
+bool ParseGesture(Napi::Object binds, ChordParser parse, Gesture &gesture)
+{
+	static const struct {
+		const char *name;
+		GestureKind kind;
+		uint32_t ms;
+	} kinds[] = {
+		{"hold", GestureKind::Hold, 300},
+		{"longPress", GestureKind::LongPress, 600},
+		{"doubleTap", GestureKind::DoubleTap, 300},
+	};
+
+	std::string name = binds.Get("kind").ToString().Utf8Value();
+	auto kind = std::find_if(std::begin(kinds), std::end(kinds), [&name](const decltype(kinds[0]) &k) { return name == k.name; });
+	if (kind == std::end(kinds))
+		return false;
+
+	Chord chord;
+	Napi::Object modifiers = binds.Has("modifiers") ? binds.Get("modifiers").ToObject() : Napi::Object::New(binds.Env());
+	if (!parse(binds.Get("key").ToString().Utf8Value(), modifiers, chord))
+		return false;
+
+	gesture.kind = kind->kind;
+	gesture.key = chord.key;
+	gesture.modifiers = chord.modifiers;
+	gesture.ms = binds.Has("ms") ? binds.Get("ms").ToNumber().Uint32Value() : kind->ms;
+	return gesture.ms > 0;
+}
+
+ChordId NextSequenceId()
+{
+	// Shared by the environments' JS threads.
+	static std::atomic<uint32_t> serial{0};
+	return MakeSequenceId(serial.fetch_add(1, std::memory_order_relaxed));
+}
+
+Napi::Array ParseHotkeyBindings(Napi::Value value, ChordParser parse, bool replace, std::vector<HotkeyBinding> &bindings)
+{
+	Napi::Env env = value.Env();
+	Napi::Array array = value.IsArray() ? value.As<Napi::Array>() : Napi::Array::New(env);
+	Napi::Array results = Napi::Array::New(env, array.Length());
+
+	ChordMap<uint8_t> seen; // edges taken earlier in the same array
+	for (uint32_t i = 0; i < array.Length(); i++) {
+		Napi::Value entry = array.Get(i);
+		Napi::Object binds = entry.IsObject() ? entry.ToObject() : Napi::Object::New(env);
+		Napi::Value modifiers = binds.Get("modifiers");
+		std::string eventString = binds.Get("eventType").ToString().Utf8Value();
+
+		HotkeyBinding binding;
+		const char *error = nullptr;
+		if (!parse(binds.Get("key").ToString().Utf8Value(), modifiers.IsObject() ? modifiers.ToObject() : Napi::Object::New(env), binding.chord))
+			error = "unknown key";
+		else if (eventString != "registerKeydown" && eventString != "registerKeyup")
+			error = "invalid event type";
+		else if (!binds.Get("callback").IsFunction())
+			error = "invalid callback";
+
+		if (!error) {
+			binding.id = MakeChordId(binding.chord);
+			binding.edge = eventString == "registerKeydown" ? KeyEdge::Pressed : KeyEdge::Released;
+			uint8_t bit = 1 << (uint8_t)binding.edge;
+			uint8_t &edges = seen[binding.id];
+			if ((edges & bit) || (!replace && GetHotkeyDelivery(env).HasCallback(binding.id, binding.edge)))
+				error = "already registered";
+			edges |= bit;
+		}
+
+		if (error) {
+			results.Set(i, Napi::String::New(env, error));
+			continue;
+		}
+
+		binding.consume = binds.Get("consume").ToBoolean().Value();
+		binding.callback = binds.Get("callback").As<Napi::Function>();
+		bindings.push_back(binding);
+		results.Set(i, Napi::Boolean::New(env, true));
+	}
+	return results;
+}
+
+Napi::Value SetEventQueueOptionsJS(const Napi::CallbackInfo &info)
+{
+	/* interface IEventQueueOptions {
+	 *   size?: number; // events buffered between the hook and JS
+	 *   overflow?: 'dropNewest' | 'dropOldest';
+	 * }
+	 */
+	if (info.Length() < 1 || !info[0].IsObject())
+		return Napi::Boolean::New(info.Env(), false);
+
+	Napi::Object options = info[0].ToObject();
+	HotkeyDelivery::Options parsed;
+
+	if (options.Has("size")) {
+		double size = options.Get("size").ToNumber().DoubleValue();
+		if (!(size >= 1 && size <= (1 << 20)))
+			return Napi::Boolean::New(info.Env(), false);
+		parsed.size = (size_t)size;
+	}
+
+	if (options.Has("overflow")) {
+		std::string overflow = options.Get("overflow").ToString().Utf8Value();
+		if (overflow == "dropNewest")
+			parsed.overflow = OverflowPolicy::DropNewest;
+		else if (overflow == "dropOldest")
+			parsed.overflow = OverflowPolicy::DropOldest;
+		else
+			return Napi::Boolean::New(info.Env(), false);
+	}
+
+	GetHotkeyDelivery(info.Env()).SetOptions(parsed);
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value GetDroppedEventCountJS(const Napi::CallbackInfo &info)
+{
+	return Napi::Number::New(info.Env(), (double)GetHotkeyDelivery(info.Env()).Dropped());
+}
+
+static Napi::Object Summarize(Napi::Env env, const LatencyHistogram &histogram)
+{
+	Napi::Object summary = Napi::Object::New(env);
+	summary.Set("count", Napi::Number::New(env, (double)histogram.Count()));
+	summary.Set("p50", Napi::Number::New(env, histogram.Percentile(0.5) / 1000.0));
+	summary.Set("p99", Napi::Number::New(env, histogram.Percentile(0.99) / 1000.0));
+	summary.Set("max", Napi::Number::New(env, histogram.Max() / 1000.0));
+	return summary;
+}
+
+Napi::Value GetStatsJS(const Napi::CallbackInfo &info)
+{
+	/* interface IStats {
+	 *   events: number;  // key events captured
+	 *   matched: number; // hotkeys fired
+	 *   dropped: number; // fired hotkeys lost to a full queue
+	 *   queueDepth: number;
+	 *   maxQueueDepth: number;
+	 *   arms: number;  // lazy hook starts
+	 *   parks: number; // lazy hook stops
+	 *   latency: { match, enqueue, js, arm: { count, p50, p99, max } };
+	 * }
+	 * Latencies are in microseconds since the hook received the key, arm
+	 * latency since the binding that needed the hook.
+	 */
+	Napi::Env env = info.Env();
+	const HotkeyDelivery &delivery = GetHotkeyDelivery(env);
+	const DeliveryStats &stats = delivery.Stats();
+
+	Napi::Object latency = Napi::Object::New(env);
+	latency.Set("match", Summarize(env, stats.match));
+	latency.Set("enqueue", Summarize(env, stats.enqueue));
+	latency.Set("js", Summarize(env, stats.js));
+	latency.Set("arm", Summarize(env, stats.arm));
+
+	Napi::Object result = Napi::Object::New(env);
+	result.Set("events", Napi::Number::New(env, (double)stats.events.load(std::memory_order_relaxed)));
+	result.Set("matched", Napi::Number::New(env, (double)stats.matched.load(std::memory_order_relaxed)));
+	result.Set("dropped", Napi::Number::New(env, (double)delivery.Dropped()));
+	result.Set("queueDepth", Napi::Number::New(env, (double)delivery.QueueDepth()));
+	result.Set("maxQueueDepth", Napi::Number::New(env, (double)stats.maxQueueDepth.load(std::memory_order_relaxed)));
+	result.Set("arms", Napi::Number::New(env, (double)stats.arms.load(std::memory_order_relaxed)));
+	result.Set("parks", Napi::Number::New(env, (double)stats.parks.load(std::memory_order_relaxed)));
+	result.Set("latency", latency);
+	return result;
+}
+
+Napi::Value SetBatchCallbackJS(const Napi::CallbackInfo &info)
+{
+	/* setBatchCallback((records: Uint32Array) => void): records holds
+	 * [bindingId, eventType, timestamp] triples, eventType 0 for keydown
+	 * and 1 for keyup, timestamp in wrapping monotonic milliseconds.
+	 * Pass null to go back to per-binding callbacks.
+	 */
+	if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+		GetHotkeyDelivery(info.Env()).SetBatchCallback(Napi::Function());
+		return Napi::Boolean::New(info.Env(), true);
+	}
+
+	if (!info[0].IsFunction())
+		return Napi::Boolean::New(info.Env(), false);
+
+	GetHotkeyDelivery(info.Env()).SetBatchCallback(info[0].As<Napi::Function>());
+	return Napi::Boolean::New(info.Env(), true);
+}
@@ -0,0 +1,156 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "event-queue.h"
+#include "hotkey-engine.h"
+#include "latency-histogram.h"
+
+#include <napi.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct HotkeyEvent {
+	ChordId id;
+	uint32_t edge;     // KeyEdge
+	uint32_t time;     // steady clock milliseconds, wrapping
+	uint64_t captured; // steady clock nanoseconds when the hook got the key
+};
+
+// Where fired hotkeys spend their time. Each stage is measured from the
+// moment the hook received the key event, so the JS stage is the end to end
+// latency. Matching and enqueueing are recorded on the hook thread, the JS
+// stage on the JS thread.
+struct DeliveryStats {
+	std::atomic<uint64_t> events{0};  // key events captured
+	std::atomic<uint64_t> matched{0}; // hotkeys fired
+	std::atomic<uint64_t> maxQueueDepth{0};
+	LatencyHistogram match;   // until the engine fired the hotkey
+	LatencyHistogram enqueue; // until it was in the queue
+	LatencyHistogram js;      // until its JS callback was called
+
+	// Lazy hook, see HookClient. Arming is measured from the binding that
+	// needed the hook until the hook was capturing.
+	std::atomic<uint64_t> arms{0};
+	std::atomic<uint64_t> parks{0};
+	LatencyHistogram arm;
+};
+
+// Hands fired hotkeys from the hook thread to JS. The hook thread only pushes
+// into a lock-free ring and schedules at most one wake-up of the JS thread;
+// the JS thread then drains the ring and calls the registered callbacks. The
+// hook never waits on JS, however busy the main thread is.
+//
+// By default each event calls its binding's callback. In batch mode all events
+// of a drain go to one callback as a Uint32Array of (bindingId, eventType,
+// timestamp) records instead, so a burst costs one JS call and one allocation.
+//
+// Everything but Push runs on the JS thread.
+class HotkeyDelivery {
+public:
+	struct Options {
+		size_t size = 1024;
+		OverflowPolicy overflow = OverflowPolicy::DropNewest;
+	};
+
+	void Start(Napi::Env env);
+	void Stop();
+
+	// Take effect on the next Start.
+	void SetOptions(const Options &options) { m_options = options; };
+
+	// False if the edge already has a callback.
+	bool SetCallback(ChordId id, KeyEdge edge, Napi::Function callback);
+	// False if the edge had no callback.
+	bool RemoveCallback(ChordId id, KeyEdge edge);
+	bool HasCallbacks(ChordId id) const;
+	bool HasCallback(ChordId id, KeyEdge edge) const;
+	size_t Bindings() const { return m_callbacks.Size(); };
+	void Clear();
+
+	// An empty function turns batch mode off.
+	void SetBatchCallback(Napi::Function callback);
+
+	uint64_t Dropped() const { return m_dropped + (m_ring ? m_ring->Dropped() : 0); };
+
+	const DeliveryStats &Stats() const { return m_stats; };
+	DeliveryStats &Stats() { return m_stats; };
+	size_t QueueDepth() const { return m_ring ? m_ring->Size() : 0; };
+
+	// Hook thread only. Captured timestamps a key event before it's matched,
+	// the hotkeys it fires are then measured from there. Ticked does the same
+	// for gesture timers, without counting an event.
+	void Captured();
+	void Ticked();
+	void Push(ChordId id, KeyEdge edge);
+
+private:
+	struct Callbacks {
+		Napi::FunctionReference down, up;
+	};
+
+	void Drain(Napi::Env env);
+	void DrainBatch(Napi::Env env);
+	void Wake();
+
+	ChordMap<Callbacks> m_callbacks;
+	Napi::FunctionReference m_batchCallback;
+	std::vector<uint32_t> m_batch;
+	std::vector<uint64_t> m_batchCaptured;
+	std::unique_ptr<SpscRing<HotkeyEvent>> m_ring;
+	Napi::ThreadSafeFunction m_wake;
+	std::atomic<bool> m_wakePending{false};
+	Options m_options;
+	uint64_t m_dropped = 0; // by rings of earlier runs
+
+	DeliveryStats m_stats;
+	uint64_t m_captured = 0; // hook thread only
+};
+
+// The calling environment's, see HookClient.
+HotkeyDelivery &GetHotkeyDelivery(Napi::Env env);
+
+// Parses the steps of a registerSequence() binding with the backend's chord
+// parser. The default timeout applies to steps without their own.
+typedef bool (*ChordParser)(const std::string &key, Napi::Object modifiers, Chord &chord);
+bool ParseSequenceSteps(Napi::Object binds, ChordParser parse, std::vector<SequenceTrie::Step> &steps);
+// Parses all of a registerGesture() binding but its id.
+bool ParseGesture(Napi::Object binds, ChordParser parse, Gesture &gesture);
+// Sequences and gestures share the numbering.
+ChordId NextSequenceId();
+
+// One entry of a registerCallbacks() or replaceAllCallbacks() array.
+struct HotkeyBinding {
+	ChordId id;
+	Chord chord;
+	KeyEdge edge;
+	bool consume;
+	Napi::Function callback;
+};
+
+// Validates every entry up front. Returns an array with true or the reason
+// for each entry, the accepted ones are appended to bindings. Callbacks that
+// are registered already only conflict when not replacing them.
+Napi::Array ParseHotkeyBindings(Napi::Value value, ChordParser parse, bool replace, std::vector<HotkeyBinding> &bindings);
+
+// JS API shared by all platforms.
+Napi::Value SetEventQueueOptionsJS(const Napi::CallbackInfo &info);
+Napi::Value GetDroppedEventCountJS(const Napi::CallbackInfo &info);
+Napi::Value SetBatchCallbackJS(const Napi::CallbackInfo &info);
+Napi::Value GetStatsJS(const Napi::CallbackInfo &info);
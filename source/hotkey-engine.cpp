@@ -0,0 +1,286 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "hotkey-engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+HotkeyEngine::HotkeyEngine(FireCallback fire, KeyState state)
+	: m_fire(std::move(fire)), m_tables(std::unique_ptr<HotkeyTable>(new HotkeyTable())), m_state(state)
+{
+	m_clock = []() {
+		return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	};
+}
+
+void HotkeyEngine::SetHotkey(ChordId id, Chord chord, bool consume)
+{
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	SetHotkey(*table, id, chord, consume);
+	Publish(std::move(table));
+}
+
+void HotkeyEngine::RemoveHotkey(ChordId id)
+{
+	if (!Table().FindSlot(id))
+		return;
+
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	table->RemoveHotkey(id);
+	Publish(std::move(table));
+}
+
+bool HotkeyEngine::SetSequence(ChordId id, const std::vector<SequenceTrie::Step> &steps)
+{
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	if (!table->Sequences().Add(id, steps))
+		return false;
+
+	Publish(std::move(table));
+	return true;
+}
+
+void HotkeyEngine::RemoveSequence(ChordId id)
+{
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	if (table->Sequences().Remove(id))
+		Publish(std::move(table));
+}
+
+bool HotkeyEngine::SetGesture(const Gesture &gesture)
+{
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	if (!table->SetGesture(gesture))
+		return false;
+
+	Publish(std::move(table));
+	return true;
+}
+
+void HotkeyEngine::RemoveGesture(ChordId id)
+{
+	if (!Table().FindGesture(id))
+		return;
+
+	std::unique_ptr<HotkeyTable> table = CopyTable();
+	table->RemoveGesture(id);
+	Publish(std::move(table));
+}
+
+void HotkeyEngine::Clear()
+{
+	Publish(std::unique_ptr<HotkeyTable>(new HotkeyTable()));
+}
+
+void HotkeyEngine::ResetState()
+{
+	m_state.Reset();
+	m_held.clear();
+	m_swallowed.clear();
+	std::fill(m_chords.begin(), m_chords.end(), Up);
+	m_gestures.assign(m_gestures.size(), GestureState());
+	m_timers.Clear();
+	m_cursor = {};
+}
+
+void HotkeyEngine::Switch(const HotkeyTable &next)
+{
+	// Only chords of held keys can be down. One that was down before keeps
+	// its relaxed modifier check, so it isn't released by the switch alone.
+	const HotkeyTable &current = m_tables.Current();
+	std::vector<ChordState> chords(next.SlotCount(), Up);
+	for (keycode_t key : m_held) {
+		for (uint32_t slot : next.Candidates(key)) {
+			const HotkeyTable::Hotkey &hk = next.Slot(slot);
+			const uint32_t *old = current.FindSlot(hk.id);
+			chords[slot] = old ? m_chords[*old] : Up;
+			if (chords[slot] == Up && IsActive(hk.chord, false))
+				chords[slot] = DownUnreported;
+		}
+	}
+
+	// Gestures in progress carry on, removed ones stop without firing.
+	std::vector<GestureState> gestures(next.GestureSlotCount());
+	for (uint32_t slot = 0; slot < m_gestures.size(); slot++) {
+		if (m_gestures[slot].phase == Idle)
+			continue;
+		const uint32_t *kept = next.FindGesture(current.GestureSlot(slot).id);
+		if (kept)
+			gestures[*kept] = m_gestures[slot];
+		else
+			m_timers.Cancel(m_gestures[slot].timer);
+	}
+
+	m_chords.swap(chords);
+	m_gestures.swap(gestures);
+	// A sequence being typed carries on unless nodes went away.
+	if (next.Sequences().Epoch() != current.Sequences().Epoch())
+		m_cursor = {};
+	m_tables.Adopt(&next);
+}
+
+bool HotkeyEngine::Evaluate(const HotkeyTable &table, keycode_t key)
+{
+	bool consumed = false;
+	for (uint32_t slot : table.Candidates(key)) {
+		const HotkeyTable::Hotkey &hk = table.Slot(slot);
+		ChordState &state = m_chords[slot];
+
+		bool active = IsActive(hk.chord, state != Up);
+		if (active && state == Up) {
+			state = Down;
+			consumed |= hk.consume;
+			m_fire(hk.id, KeyEdge::Pressed);
+		} else if (!active && state != Up) {
+			if (state == Down)
+				m_fire(hk.id, KeyEdge::Released);
+			state = Up;
+		}
+	}
+	return consumed;
+}
+
+void HotkeyEngine::RunTimers(uint32_t now)
+{
+	m_timers.Advance(now, [this](ChordId id) { OnTimer(id); });
+}
+
+void HotkeyEngine::OnTimer(ChordId id)
+{
+	const HotkeyTable &table = m_tables.Current();
+	const uint32_t *slot = table.FindGesture(id);
+	if (!slot)
+		return;
+
+	GestureState &state = m_gestures[*slot];
+	state.timer = 0;
+	if (table.GestureSlot(*slot).kind == GestureKind::DoubleTap) {
+		state.phase = Idle;
+	} else if (state.phase == Pending) {
+		state.phase = Active;
+		m_fire(id, KeyEdge::Pressed);
+	}
+}
+
+void HotkeyEngine::PressGestures(const HotkeyTable &table, keycode_t key, uint32_t now)
+{
+	uint8_t modifiers = m_state.Modifiers() & ~m_state.ModifierOf(key);
+	for (uint32_t slot : table.GestureCandidates(key)) {
+		const Gesture &gesture = table.GestureSlot(slot);
+		GestureState &state = m_gestures[slot];
+		if (gesture.modifiers != modifiers) {
+			m_timers.Cancel(state.timer);
+			state = {};
+		} else if (state.phase == Tapped) {
+			m_timers.Cancel(state.timer);
+			state = {};
+			m_fire(gesture.id, KeyEdge::Pressed);
+		} else if (state.phase == Idle) {
+			state.phase = Pending;
+			state.timer = m_timers.Schedule(now + gesture.ms, gesture.id);
+		}
+	}
+}
+
+void HotkeyEngine::ReleaseGestures(const HotkeyTable &table, keycode_t key)
+{
+	for (uint32_t slot : table.GestureCandidates(key)) {
+		const Gesture &gesture = table.GestureSlot(slot);
+		GestureState &state = m_gestures[slot];
+		if (state.phase == Idle || state.phase == Tapped)
+			continue;
+
+		if (gesture.kind == GestureKind::DoubleTap && state.phase == Pending) {
+			state.phase = Tapped;
+			continue;
+		}
+		if (gesture.kind == GestureKind::Hold && state.phase == Active)
+			m_fire(gesture.id, KeyEdge::Released);
+		m_timers.Cancel(state.timer);
+		state = {};
+	}
+}
+
+int32_t HotkeyEngine::Tick()
+{
+	if (const HotkeyTable *next = m_tables.Peek())
+		Switch(*next);
+	if (m_timers.Size() == 0)
+		return -1;
+
+	RunTimers(m_clock());
+	return m_timers.NextIn();
+}
+
+bool HotkeyEngine::OnKeyEvent(const KeyEvent &event)
+{
+	// Switch against the keys as they were when the table was published.
+	if (const HotkeyTable *next = m_tables.Peek())
+		Switch(*next);
+
+	// A swallowed press takes its repeats and release along, whatever the
+	// bindings are by then.
+	auto swallowed = std::find(m_swallowed.begin(), m_swallowed.end(), event.key);
+	bool consume = swallowed != m_swallowed.end();
+	if (consume && !event.down)
+		m_swallowed.erase(swallowed);
+
+	// Auto-repeat and duplicate notifications are not edges.
+	KeyEvent edges[2];
+	size_t count = m_state.Update(event, edges);
+	if (count == 0)
+		return consume;
+
+	const HotkeyTable &table = m_tables.Current();
+	const SequenceTrie &sequences = table.Sequences();
+	bool gestures = table.GestureCount() > 0 || m_timers.Size() > 0;
+	uint32_t now = gestures || sequences.Size() > 0 ? m_clock() : 0;
+	// Timers that expired before this event go first.
+	if (gestures)
+		RunTimers(now);
+
+	for (size_t i = 0; i < count; i++) {
+		if (edges[i].down) {
+			m_held.push_back(edges[i].key);
+			if (sequences.Size() > 0 && !m_state.ModifierOf(edges[i].key)) {
+				ChordId done = sequences.Advance(m_cursor, MakeChordId(edges[i].key, m_state.Modifiers()), now);
+				if (done != SequenceTrie::None)
+					m_fire(done, KeyEdge::Pressed);
+			}
+			if (gestures)
+				PressGestures(table, edges[i].key, now);
+		} else {
+			m_held.erase(std::find(m_held.begin(), m_held.end(), edges[i].key));
+			Evaluate(table, edges[i].key);
+			if (gestures)
+				ReleaseGestures(table, edges[i].key);
+		}
+	}
+
+	// Hotkeys are candidates of their own key, so only the pressed key's (or
+	// the generic modifier's that went down with it) can consume it.
+	for (keycode_t held : m_held) {
+		bool pressed = event.down && (held == edges[0].key || (count == 2 && held == edges[1].key));
+		if (Evaluate(table, held) && pressed && !consume) {
+			m_swallowed.push_back(event.key);
+			consume = true;
+		}
+	}
+	return consume;
+}
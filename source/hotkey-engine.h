@@ -0,0 +1,196 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "hotkey-table.h"
+#include "input-filter.h"
+#include "key-state.h"
+#include "rcu-pointer.h"
+#include "timer-wheel.h"
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+enum class KeyEdge : uint8_t { Pressed, Released };
+
+// Anything that produces raw key transitions. The platform backends wrap the
+// OS hook with it; tests feed synthetic events through the same interface.
+class KeyEventSource {
+public:
+	typedef std::function<void(const KeyEvent &)> Sink;
+	typedef std::function<void(const InputEvent &)> InputSink;
+	// Runs what is due and returns the milliseconds until it wants to be
+	// called again, -1 for never.
+	typedef std::function<int32_t()> TimerSink;
+
+	virtual ~KeyEventSource(){};
+
+	virtual bool Start(Sink sink) = 0;
+	virtual void Stop() = 0;
+
+	// Optionally also receives every raw event, mouse motion included, on
+	// the source's thread. Set before Start.
+	void SetInputSink(InputSink sink) { m_inputSink = std::move(sink); };
+	// Sources that can keep a key event from the focused application give key
+	// events to the filter instead of the sink when one is set, and swallow
+	// the ones it returns true for. Set before Start.
+	typedef std::function<bool(const KeyEvent &)> KeyFilter;
+	void SetKeyFilter(KeyFilter filter) { m_keyFilter = std::move(filter); };
+
+	// Optionally called on the source's thread whenever it is about to wait
+	// for input, and again once the wait it asked for is over. Set before
+	// Start.
+	void SetTimerSink(TimerSink sink) { m_timerSink = std::move(sink); };
+	// Any thread while started. Makes the source's thread call the timer
+	// sink again soon, without waiting for input.
+	virtual void Wake(){};
+
+protected:
+	InputSink m_inputSink;
+	TimerSink m_timerSink;
+	KeyFilter m_keyFilter;
+};
+
+// Edge-triggered chord matcher. State only changes when a key goes down or up,
+// so nothing runs between input events, except for gestures.
+//
+// Sequences advance on presses of non-modifier keys, with the modifiers held
+// at that moment, and fire a single Pressed edge when completed.
+//
+// A hotkey bound with consume swallows the press of its key that activates it,
+// and that key's repeats and release, so the focused application never sees
+// any of them. The verdict is made while matching, on the hook thread, before
+// the source hands the event on; only the callbacks run later in JS. Other keys
+// of the chord, the modifiers, pass through.
+//
+// Gestures (see GestureKind) start timers on a timer wheel when their key goes
+// down. Due timers run at the start of every key event and from Tick, which
+// the source calls when the next one is due, so a hold is confirmed on time
+// even when no other input arrives.
+//
+// Each hotkey is indexed under its key. A chord can only change state while
+// its key is held or changing, so an event evaluates the hotkeys of the keys
+// currently held plus the one that changed, regardless of how many hotkeys
+// are registered.
+//
+// OnKeyEvent runs on the hook thread, everything else on one other thread,
+// without any lock between them. Bindings are read-copy-update: every edit
+// copies the table and publishes the copy, and the hook thread switches to
+// the newest table at its next event. Many edits are best made on one copy:
+// CopyTable, SetHotkey on the copy, then Publish.
+class HotkeyEngine {
+public:
+	typedef std::function<void(ChordId id, KeyEdge edge)> FireCallback;
+	// Monotonic milliseconds, wrapping.
+	typedef std::function<uint32_t()> Clock;
+
+	HotkeyEngine(FireCallback fire, KeyState state = KeyState());
+
+	void SetHotkey(ChordId id, Chord chord, bool consume = false);
+	void RemoveHotkey(ChordId id);
+	// See SequenceTrie::Add, the chords are matched exactly.
+	bool SetSequence(ChordId id, const std::vector<SequenceTrie::Step> &steps);
+	void RemoveSequence(ChordId id);
+	// False if the id is already used.
+	bool SetGesture(const Gesture &gesture);
+	void RemoveGesture(ChordId id);
+	void Clear();
+
+	// Whether the newest table's hotkey consumes its key.
+	bool Consumes(ChordId id) const
+	{
+		const uint32_t *slot = Table().FindSlot(id);
+		return slot && Table().Slot(*slot).consume;
+	};
+
+	// The newest table, valid until the next edit.
+	const HotkeyTable &Table() const { return m_tables.Latest(); };
+	std::unique_ptr<HotkeyTable> CopyTable() const { return std::unique_ptr<HotkeyTable>(new HotkeyTable(Table())); };
+	// Adds to a table that isn't published yet.
+	void SetHotkey(HotkeyTable &table, ChordId id, Chord chord, bool consume = false) const { table.SetHotkey(id, Normalize(chord), consume); };
+	// Chords that are held when the hook thread switches stay held without
+	// firing again, chords bound while their keys are held wait for the next
+	// press. Old tables are freed once the hook thread left them.
+	void Publish(std::unique_ptr<HotkeyTable> table) { m_tables.Publish(std::move(table)); };
+	// Tables still waiting for the hook thread to leave them.
+	size_t RetiredTables() { return m_tables.Reclaim(); };
+
+	void SetClock(Clock clock) { m_clock = std::move(clock); };
+
+	// Hook thread only. True if the event is to be swallowed.
+	bool OnKeyEvent(const KeyEvent &event);
+	const KeyState &State() const { return m_state; };
+	// Forgets the keys held and everything in progress, for an engine the
+	// hook thread stops feeding for a while (a parked client) and so misses
+	// releases. Only while no hook thread uses it.
+	void ResetState();
+	// Runs the gesture timers that are due. Returns the milliseconds until
+	// the next one, -1 if none is pending.
+	int32_t Tick();
+	size_t Timers() const { return m_timers.Size(); };
+
+private:
+	// A modifier used as the key itself can't also be required to be up.
+	// Only reads the modifier keys, which never change.
+	Chord Normalize(Chord chord) const
+	{
+		chord.care |= chord.modifiers;
+		chord.care &= ~(m_state.ModifierOf(chord.key) & ~chord.modifiers);
+		return chord;
+	};
+	bool IsActive(const Chord &chord, bool wasDown) const
+	{
+		uint8_t care = wasDown ? chord.modifiers : chord.care;
+		return (m_state.Modifiers() & care) == chord.modifiers && m_state.IsDown(chord.key);
+	};
+	// Per slot. A chord that was already held when it got bound is down, but
+	// never reported, so it's released silently too.
+	enum ChordState : uint8_t { Up, Down, DownUnreported };
+
+	// Per gesture slot. Pending waits for the hold or for the first tap to be
+	// released, Tapped for the second tap.
+	enum GesturePhase : uint8_t { Idle, Pending, Active, Tapped };
+	struct GestureState {
+		GesturePhase phase = Idle;
+		TimerWheel<ChordId>::Handle timer = 0;
+	};
+
+	void Switch(const HotkeyTable &next);
+	// True if a consuming hotkey went down.
+	bool Evaluate(const HotkeyTable &table, keycode_t key);
+	void RunTimers(uint32_t now);
+	void OnTimer(ChordId id);
+	void PressGestures(const HotkeyTable &table, keycode_t key, uint32_t now);
+	void ReleaseGestures(const HotkeyTable &table, keycode_t key);
+
+	FireCallback m_fire;
+	Clock m_clock;
+	RcuPointer<HotkeyTable> m_tables;
+
+	// Hook thread state.
+	KeyState m_state;
+	std::vector<keycode_t> m_held;
+	std::vector<ChordState> m_chords; // per slot of the current table
+	SequenceTrie::Cursor m_cursor;
+	std::vector<keycode_t> m_swallowed; // pressed keys kept from the application
+	std::vector<GestureState> m_gestures; // per gesture slot of the current table
+	TimerWheel<ChordId> m_timers;          // gesture ids
+};
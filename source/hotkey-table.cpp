@@ -0,0 +1,95 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "hotkey-table.h"
+
+uint32_t HotkeyTable::SetHotkey(ChordId id, const Chord &chord, bool consume)
+{
+	RemoveHotkey(id);
+
+	uint32_t slot;
+	if (!m_freeSlots.empty()) {
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	} else {
+		slot = (uint32_t)m_slots.size();
+		m_slots.emplace_back();
+	}
+
+	m_slots[slot] = {id, chord, consume};
+	m_slotById[id] = slot;
+	m_dispatch.Add(chord.key, slot);
+	return slot;
+}
+
+bool HotkeyTable::RemoveHotkey(ChordId id)
+{
+	uint32_t *slot = m_slotById.Find(id);
+	if (!slot)
+		return false;
+
+	m_dispatch.Remove(m_slots[*slot].chord.key, *slot);
+	m_freeSlots.push_back(*slot);
+	m_slotById.Erase(id);
+	return true;
+}
+
+bool HotkeyTable::SetGesture(const Gesture &gesture)
+{
+	if (m_gestureById.Find(gesture.id))
+		return false;
+
+	uint32_t slot;
+	if (!m_freeGestures.empty()) {
+		slot = m_freeGestures.back();
+		m_freeGestures.pop_back();
+	} else {
+		slot = (uint32_t)m_gestures.size();
+		m_gestures.emplace_back();
+	}
+
+	m_gestures[slot] = gesture;
+	m_gestureById[gesture.id] = slot;
+	m_gestureDispatch.Add(gesture.key, slot);
+	return true;
+}
+
+bool HotkeyTable::RemoveGesture(ChordId id)
+{
+	uint32_t *slot = m_gestureById.Find(id);
+	if (!slot)
+		return false;
+
+	m_gestureDispatch.Remove(m_gestures[*slot].key, *slot);
+	m_freeGestures.push_back(*slot);
+	m_gestureById.Erase(id);
+	return true;
+}
+
+void HotkeyTable::Clear()
+{
+	m_slots.clear();
+	m_freeSlots.clear();
+	m_slotById.Clear();
+	m_dispatch.Clear();
+	m_sequences.Clear();
+	m_gestures.clear();
+	m_freeGestures.clear();
+	m_gestureById.Clear();
+	m_gestureDispatch.Clear();
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "chord-map.h"
+#include "dispatch-table.h"
+#include "key-state.h"
+#include "sequence-trie.h"
+
+#include <stdint.h>
+#include <vector>
+
+// A key plus the modifiers that must be held with it. Modifiers in care but
+// not in modifiers must be up for the chord to activate, but pressing them
+// while the chord is held does not release it. Backends that match modifiers
+// exactly set care to MOD_ALL, the ones that accept extra modifiers set it to
+// modifiers.
+struct Chord {
+	keycode_t key;
+	uint8_t modifiers;
+	uint8_t care;
+};
+
+// Canonical binding identity: the key in bits 0-15 and its modifier mask in
+// bits 16-23. Equal chords get equal ids and different ones never collide.
+inline constexpr ChordId MakeChordId(keycode_t key, uint8_t modifiers)
+{
+	return (ChordId)key | (ChordId)modifiers << 16;
+}
+
+inline constexpr ChordId MakeChordId(const Chord &chord)
+{
+	return MakeChordId(chord.key, chord.modifiers);
+}
+
+// Sequence bindings are numbered separately, bit 31 keeps them apart from
+// chord ids while still fitting the 32 bit bindingId of batched records.
+inline constexpr ChordId MakeSequenceId(uint32_t serial)
+{
+	return (ChordId)1 << 31 | (serial & 0x7FFFFFFF);
+}
+
+// Bindings on the timing of one chord rather than on the chord alone, matched
+// on the hook thread next to the plain hotkeys:
+//  - Hold fires Pressed once the chord was held for ms, and Released when it
+//    is let go after that, so push-to-talk ignores short taps.
+//  - LongPress fires Pressed once the chord was held for ms, and nothing else.
+//  - DoubleTap fires Pressed on the second press of the chord when it comes
+//    within ms of the first one.
+// The modifiers must match exactly when the key is pressed.
+enum class GestureKind : uint8_t { Hold, LongPress, DoubleTap };
+
+struct Gesture {
+	ChordId id;
+	GestureKind kind;
+	keycode_t key;
+	uint8_t modifiers;
+	uint32_t ms;
+};
+
+// The bindings a HotkeyEngine matches against, without any key state, so a
+// whole set can be copied, edited and swapped in while the engine keeps
+// running on the old one. Matching only reads it.
+//
+// Hotkeys live in stable slots, the dispatch table stores slot indices.
+class HotkeyTable {
+public:
+	struct Hotkey {
+		ChordId id;
+		Chord chord;
+		bool consume; // keep the key from the focused application
+	};
+
+	// Replaces a hotkey with the same id. Returns its slot.
+	uint32_t SetHotkey(ChordId id, const Chord &chord, bool consume = false);
+	bool RemoveHotkey(ChordId id);
+	void Clear();
+
+	size_t Size() const { return m_slotById.Size(); };
+	size_t SlotCount() const { return m_slots.size(); };
+	const Hotkey &Slot(uint32_t slot) const { return m_slots[slot]; };
+	const uint32_t *FindSlot(ChordId id) const { return m_slotById.Find(id); };
+	const std::vector<uint32_t> &Candidates(keycode_t key) const { return m_dispatch.Candidates(key); };
+
+	SequenceTrie &Sequences() { return m_sequences; };
+	const SequenceTrie &Sequences() const { return m_sequences; };
+
+	// Gestures have slots of their own. False if the id is already used.
+	bool SetGesture(const Gesture &gesture);
+	bool RemoveGesture(ChordId id);
+	size_t GestureCount() const { return m_gestureById.Size(); };
+	size_t GestureSlotCount() const { return m_gestures.size(); };
+	const Gesture &GestureSlot(uint32_t slot) const { return m_gestures[slot]; };
+	const uint32_t *FindGesture(ChordId id) const { return m_gestureById.Find(id); };
+	const std::vector<uint32_t> &GestureCandidates(keycode_t key) const { return m_gestureDispatch.Candidates(key); };
+
+private:
+	std::vector<Hotkey> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	ChordMap<uint32_t> m_slotById;
+	KeyDispatchTable<uint32_t> m_dispatch;
+
+	SequenceTrie m_sequences;
+
+	std::vector<Gesture> m_gestures;
+	std::vector<uint32_t> m_freeGestures;
+	ChordMap<uint32_t> m_gestureById;
+	KeyDispatchTable<uint32_t> m_gestureDispatch;
+};
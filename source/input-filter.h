@@ -0,0 +1,173 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "key-state.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Values are part of the JS API (the type field of subscribe() records).
+enum class InputType : uint8_t {
+	KeyDown,       // code is the platform key code, repeats included
+	KeyUp,         // code is the platform key code
+	KeyTyped,      // code is the UTF-16 character (macOS only)
+	MousePressed,  // code is the button, 1 left, 2 right, 3 middle, 4-5 extra
+	MouseReleased, // code is the button
+	MouseMoved,    // x, y is the pointer position (relative motion on Linux)
+	MouseDragged,  // a move with a button held
+	MouseWheel,    // x, y is the horizontal and vertical rotation
+	Count,
+};
+
+// One raw input event as it leaves the hook thread.
+struct InputEvent {
+	InputType type;
+	uint8_t reserved;
+	uint16_t code;
+	int32_t x, y;
+	uint32_t time; // steady clock milliseconds, wrapping
+};
+
+inline bool IsKeyInput(InputType type)
+{
+	return type == InputType::KeyDown || type == InputType::KeyUp;
+}
+
+inline bool IsButtonInput(InputType type)
+{
+	return type == InputType::MousePressed || type == InputType::MouseReleased;
+}
+
+// Which raw events a subscriber wants, compiled down to a type mask, a bit per
+// key code and a bit per button, so a check is at most two bit tests. An
+// empty set of types, keys or buttons means all of them.
+class InputFilter {
+public:
+	InputFilter() { memset(m_keys, 0, sizeof(m_keys)); };
+
+	void AddType(InputType type) { m_types |= 1u << (unsigned)type; };
+	void AddKeyRange(keycode_t first, keycode_t last)
+	{
+		for (uint32_t key = first; key <= last; key++)
+			m_keys[key >> 6] |= 1ULL << (key & 63);
+		m_anyKey = false;
+	};
+	void AddButton(uint16_t button)
+	{
+		if (button < 32)
+			m_buttons |= 1u << button;
+	};
+
+	// After this, matches what either filter matched. Key and button sets
+	// of a filter whose types rule out keys or buttons don't widen the union.
+	void Merge(const InputFilter &other)
+	{
+		bool keys = Wants(KeyTypes), otherKeys = other.Wants(KeyTypes);
+		bool buttons = Wants(ButtonTypes), otherButtons = other.Wants(ButtonTypes);
+
+		if (!keys) {
+			m_anyKey = false;
+			memset(m_keys, 0, sizeof(m_keys));
+		}
+		if (otherKeys) {
+			m_anyKey = m_anyKey || other.m_anyKey;
+			for (size_t i = 0; i < KeyWords; i++)
+				m_keys[i] |= other.m_keys[i];
+		}
+
+		if (!buttons)
+			m_buttons = other.m_buttons;
+		else if (otherButtons)
+			m_buttons = m_buttons && other.m_buttons ? m_buttons | other.m_buttons : 0;
+
+		m_types = m_types && other.m_types ? m_types | other.m_types : 0;
+	};
+
+	bool Matches(const InputEvent &event) const
+	{
+		if (m_types && !(m_types >> (unsigned)event.type & 1))
+			return false;
+		if (IsKeyInput(event.type))
+			return m_anyKey || (m_keys[event.code >> 6] >> (event.code & 63) & 1);
+		if (IsButtonInput(event.type))
+			return !m_buttons || (event.code < 32 && (m_buttons >> event.code & 1));
+		return true;
+	};
+
+private:
+	friend class SharedInputFilter;
+	static const size_t KeyWords = 0x10000 / 64;
+	static const uint32_t KeyTypes = 1u << (unsigned)InputType::KeyDown | 1u << (unsigned)InputType::KeyUp;
+	static const uint32_t ButtonTypes = 1u << (unsigned)InputType::MousePressed | 1u << (unsigned)InputType::MouseReleased;
+
+	bool Wants(uint32_t types) const { return !m_types || (m_types & types); };
+
+	uint32_t m_types = 0;
+	uint32_t m_buttons = 0;
+	bool m_anyKey = true;
+	uint64_t m_keys[KeyWords];
+};
+
+// An InputFilter that one thread publishes and the hook thread reads without
+// locking. Until the first Publish it matches nothing. While a new filter is
+// being published an event may be checked against a mix of the old and new
+// one, subscribers filter again on delivery.
+class SharedInputFilter {
+public:
+	SharedInputFilter()
+	{
+		for (std::atomic<uint64_t> &word : m_keys)
+			word.store(0, std::memory_order_relaxed);
+	};
+
+	void Publish(const InputFilter &filter)
+	{
+		m_buttons.store(filter.m_buttons, std::memory_order_relaxed);
+		m_anyKey.store(filter.m_anyKey, std::memory_order_relaxed);
+		for (size_t i = 0; i < InputFilter::KeyWords; i++)
+			m_keys[i].store(filter.m_keys[i], std::memory_order_relaxed);
+		// A zero type mask means all types in InputFilter, here it's "off".
+		m_types.store(filter.m_types ? filter.m_types : AllTypes, std::memory_order_release);
+	};
+
+	void Disable() { m_types.store(0, std::memory_order_release); };
+	bool Enabled() const { return m_types.load(std::memory_order_relaxed) != 0; };
+
+	bool Matches(const InputEvent &event) const
+	{
+		if (!(m_types.load(std::memory_order_acquire) >> (unsigned)event.type & 1))
+			return false;
+		if (IsKeyInput(event.type))
+			return m_anyKey.load(std::memory_order_relaxed) || (m_keys[event.code >> 6].load(std::memory_order_relaxed) >> (event.code & 63) & 1);
+		if (IsButtonInput(event.type)) {
+			uint32_t buttons = m_buttons.load(std::memory_order_relaxed);
+			return !buttons || (event.code < 32 && (buttons >> event.code & 1));
+		}
+		return true;
+	};
+
+private:
+	static const uint32_t AllTypes = (1u << (unsigned)InputType::Count) - 1;
+
+	std::atomic<uint32_t> m_types{0};
+	std::atomic<uint32_t> m_buttons{0};
+	std::atomic<bool> m_anyKey{false};
+	std::atomic<uint64_t> m_keys[InputFilter::KeyWords];
+};
@@ -0,0 +1,274 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "input-recorder.h"
+
+#include <string.h>
+#include <chrono>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "the header count is used in place");
+
+bool InputRecorder::Start(const std::string &path)
+{
+	return Start(path, Options());
+}
+
+bool InputRecorder::Start(const std::string &path, const Options &options)
+{
+	if (m_count)
+		return false;
+
+	m_options = options;
+	if (options.maxBytes <= sizeof(TraceHeader) || options.initialRecords == 0 || options.initialRecords > MaxRecords())
+		return false;
+
+	if (!OpenFile(path))
+		return false;
+	if (!Extend(options.initialRecords)) {
+		CloseFile(0);
+		return false;
+	}
+
+	TraceHeader *header = (TraceHeader *)Base();
+	memcpy(header->magic, TraceMagic, sizeof(header->magic));
+	header->version = TraceVersion;
+	header->recordSize = sizeof(TraceRecord);
+	header->platform = (uint32_t)CurrentTracePlatform;
+	m_count = new (&header->count) std::atomic<uint64_t>(0);
+
+	m_dropped = 0;
+	m_stopping = false;
+	m_grower = std::thread(&InputRecorder::Grow, this);
+	m_active.store(true);
+	return true;
+}
+
+uint64_t InputRecorder::Stop()
+{
+	if (!m_count)
+		return 0;
+
+	// The hook thread never waits, so this side waits for it to leave.
+	m_active.store(false);
+	while (m_writers.load() != 0)
+		std::this_thread::yield();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_stopping = true;
+	}
+	m_cv.notify_one();
+	m_grower.join();
+
+	uint64_t count = m_count->load();
+	m_count = nullptr;
+	CloseFile(count);
+	m_capacity = 0;
+	return count;
+}
+
+void InputRecorder::Append(const InputEvent &event, uint64_t nowNs)
+{
+	if (!m_active.load(std::memory_order_relaxed))
+		return;
+
+	m_writers.fetch_add(1);
+	if (m_active.load()) {
+		// Only this thread writes the count, the load is just a read back.
+		uint64_t next = m_count->load(std::memory_order_relaxed);
+		if (next == 0)
+			m_startNs = nowNs;
+		if (next < m_capacity.load(std::memory_order_acquire)) {
+			*Record(next) = {nowNs - m_startNs, event};
+			m_count->store(next + 1, std::memory_order_release);
+		} else {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	m_writers.fetch_sub(1, std::memory_order_release);
+}
+
+void InputRecorder::Grow()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+	while (!m_stopping) {
+		m_cv.wait_for(lock, std::chrono::milliseconds(m_options.growIntervalMs));
+
+		// Stay at least half a file ahead, so even a burst between two checks
+		// fits.
+		uint64_t capacity = m_capacity.load(std::memory_order_relaxed);
+		uint64_t maxRecords = MaxRecords();
+		if (m_count->load(std::memory_order_relaxed) > capacity / 2 && capacity < maxRecords)
+			Extend(capacity * 2 < maxRecords ? capacity * 2 : maxRecords);
+	}
+}
+
+#ifdef _WIN32
+
+bool InputRecorder::OpenFile(const std::string &path)
+{
+	int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	if (length <= 0)
+		return false;
+	std::wstring wide(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide[0], length);
+
+	// Readers may open it while it's recorded.
+	HANDLE file = CreateFileW(wide.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+				  CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	size_t chunks = (size_t)((sizeof(TraceHeader) + MaxRecords() * sizeof(TraceRecord) + ChunkBytes - 1) / ChunkBytes);
+	m_chunks.reset(new std::atomic<char *>[chunks]);
+	for (size_t i = 0; i < chunks; i++)
+		m_chunks[i].store(nullptr, std::memory_order_relaxed);
+	m_mappedChunks = 0;
+	m_file = file;
+	return true;
+}
+
+bool InputRecorder::Extend(uint64_t records)
+{
+	uint64_t maxRecords = MaxRecords();
+	size_t chunks = (size_t)((sizeof(TraceHeader) + records * sizeof(TraceRecord) + ChunkBytes - 1) / ChunkBytes);
+	if (chunks <= m_mappedChunks)
+		return true;
+
+	// A mapping larger than the file extends the file, which works while
+	// other views of it are mapped, unlike SetEndOfFile. The views keep the
+	// mapping alive after its handle is closed.
+	uint64_t size = chunks * ChunkBytes + sizeof(TraceRecord);
+	HANDLE mapping = CreateFileMappingW((HANDLE)m_file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	if (!mapping)
+		return false;
+	for (; m_mappedChunks < chunks; m_mappedChunks++) {
+		uint64_t offset = m_mappedChunks * ChunkBytes;
+		void *view = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, (SIZE_T)(ChunkBytes + sizeof(TraceRecord)));
+		if (!view)
+			break;
+		m_chunks[m_mappedChunks].store((char *)view, std::memory_order_relaxed);
+	}
+	CloseHandle(mapping);
+	if (m_mappedChunks == 0)
+		return false;
+
+	// Every record starting in a mapped chunk fits its view.
+	uint64_t capacity = (m_mappedChunks * ChunkBytes - sizeof(TraceHeader) + sizeof(TraceRecord) - 1) / sizeof(TraceRecord);
+	m_capacity.store(capacity < maxRecords ? capacity : maxRecords, std::memory_order_release);
+	return m_mappedChunks == chunks;
+}
+
+void InputRecorder::CloseFile(uint64_t records)
+{
+	for (size_t i = 0; i < m_mappedChunks; i++) {
+		UnmapViewOfFile(m_chunks[i].load(std::memory_order_relaxed));
+		m_chunks[i].store(nullptr, std::memory_order_relaxed);
+	}
+	m_mappedChunks = 0;
+	m_chunks.reset();
+
+	// With no view left the file can be trimmed.
+	LARGE_INTEGER end;
+	end.QuadPart = (LONGLONG)(sizeof(TraceHeader) + records * sizeof(TraceRecord));
+	if (!SetFilePointerEx((HANDLE)m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile((HANDLE)m_file)) {
+		// The header count still says how much of the file is valid.
+	}
+	CloseHandle((HANDLE)m_file);
+	m_file = nullptr;
+}
+
+char *InputRecorder::Base() const
+{
+	return m_chunks[0].load(std::memory_order_relaxed);
+}
+
+TraceRecord *InputRecorder::Record(uint64_t index) const
+{
+	// Published before the capacity that covers it.
+	uint64_t offset = sizeof(TraceHeader) + index * sizeof(TraceRecord);
+	return (TraceRecord *)(m_chunks[(size_t)(offset / ChunkBytes)].load(std::memory_order_relaxed) + offset % ChunkBytes);
+}
+
+#else
+
+bool InputRecorder::OpenFile(const std::string &path)
+{
+	m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (m_fd < 0)
+		return false;
+
+	// Reserve the whole range now, so the mapping never moves. Only the part
+	// backed by the file is ever touched.
+	m_mapSize = (size_t)(sizeof(TraceHeader) + MaxRecords() * sizeof(TraceRecord));
+	void *map = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (map == MAP_FAILED) {
+		close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+	m_map = (char *)map;
+	return true;
+}
+
+bool InputRecorder::Extend(uint64_t records)
+{
+	off_t size = (off_t)(sizeof(TraceHeader) + records * sizeof(TraceRecord));
+#ifdef __linux__
+	// Allocates the blocks too, so the hook thread's page faults don't have to.
+	if (posix_fallocate(m_fd, 0, size) != 0 && ftruncate(m_fd, size) != 0)
+		return false;
+#else
+	if (ftruncate(m_fd, size) != 0)
+		return false;
+#endif
+	m_capacity.store(records, std::memory_order_release);
+	return true;
+}
+
+void InputRecorder::CloseFile(uint64_t records)
+{
+	munmap(m_map, m_mapSize);
+	if (ftruncate(m_fd, (off_t)(sizeof(TraceHeader) + records * sizeof(TraceRecord))) != 0) {
+		// The header count still says how much of the file is valid.
+	}
+	close(m_fd);
+	m_fd = -1;
+	m_map = nullptr;
+}
+
+char *InputRecorder::Base() const
+{
+	return m_map;
+}
+
+TraceRecord *InputRecorder::Record(uint64_t index) const
+{
+	return (TraceRecord *)(m_map + sizeof(TraceHeader)) + index;
+}
+
+#endif
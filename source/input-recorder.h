@@ -0,0 +1,101 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "input-trace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Appends raw input to a trace file (see input-trace.h) from the hook thread
+// without a syscall per event. The file is mapped into memory and a helper
+// thread extends it, and the mapping, ahead of the writer. The hook thread
+// only copies a record into the mapping and bumps the count in the mapped
+// header, so the file is readable up to the last record even while recording
+// or after a crash. Should the writer ever catch up with the end of the file,
+// events are dropped and counted rather than waited for.
+//
+// On macOS and Linux the file is mapped once, with address space reserved far
+// beyond its size. Windows can't map a file past its end, so there the file
+// grows in whole chunks of ChunkBytes, each mapped as a view of its own.
+class InputRecorder {
+public:
+	struct Options {
+		size_t initialRecords = 65536;
+		uint64_t maxBytes = sizeof(void *) >= 8 ? (uint64_t)4 << 30 : (uint64_t)256 << 20;
+		uint32_t growIntervalMs = 20; // how often the helper checks the fill level
+	};
+
+	~InputRecorder() { Stop(); };
+
+	bool Start(const std::string &path);
+	bool Start(const std::string &path, const Options &options);
+	// Trims the file to the records written and returns their count.
+	uint64_t Stop();
+
+	bool Recording() const { return m_active.load(std::memory_order_relaxed); };
+	uint64_t Count() const { return m_count ? m_count->load(std::memory_order_relaxed) : 0; };
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); };
+	uint64_t Capacity() const { return m_capacity.load(std::memory_order_relaxed); };
+
+	// Hook thread only. The first record's time becomes the start of the trace.
+	void Append(const InputEvent &event, uint64_t nowNs);
+
+private:
+	void Grow();
+
+	// Per platform. Extend makes room for at least records, CloseFile unmaps
+	// the file and trims it to records.
+	bool OpenFile(const std::string &path);
+	bool Extend(uint64_t records);
+	void CloseFile(uint64_t records);
+	char *Base() const;
+	TraceRecord *Record(uint64_t index) const;
+	uint64_t MaxRecords() const { return (m_options.maxBytes - sizeof(TraceHeader)) / sizeof(TraceRecord); };
+
+	std::atomic<bool> m_active{false};
+	std::atomic<int> m_writers{0}; // hook thread inside Append
+	std::atomic<uint64_t> m_capacity{0};
+	std::atomic<uint64_t> m_dropped{0};
+	std::atomic<uint64_t> *m_count = nullptr; // in the mapped header
+
+	Options m_options;
+#ifdef _WIN32
+	static constexpr uint64_t ChunkBytes = 1 << 20; // a multiple of the allocation granularity
+	void *m_file = nullptr;                         // HANDLE
+	// Views of ChunkBytes plus one record, so no record is split between two.
+	std::unique_ptr<std::atomic<char *>[]> m_chunks;
+	size_t m_mappedChunks = 0;
+#else
+	int m_fd = -1;
+	char *m_map = nullptr;
+	size_t m_mapSize = 0;
+#endif
+	uint64_t m_startNs = 0; // hook thread
+
+	std::thread m_grower;
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	bool m_stopping = false;
+};
@@ -0,0 +1,408 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "input-stream.h"
+#include "hook-client.h"
+#include "key-names.h"
+
+#include <string.h>
+#include <chrono>
+
+static uint32_t NowMs()
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t NowNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void InputStream::Start(Napi::Env env, bool relativeMotion)
+{
+	if (m_ring)
+		m_dropped += m_ring->Dropped();
+	m_ring.reset(new SpscRing<InputEvent>(4096));
+	m_motion.reset(new MotionCoalescer(relativeMotion));
+	m_motion->SetOptions(m_motionOptions);
+
+	if (!m_timer) {
+		uv_loop_t *loop = nullptr;
+		napi_get_uv_event_loop(env, &loop);
+		m_timer = new uv_timer_t;
+		uv_timer_init(loop, m_timer);
+		m_timer->data = this;
+		// A pending move alone doesn't keep the process alive.
+		uv_unref(reinterpret_cast<uv_handle_t *>(m_timer));
+	}
+
+	m_wakePending = false;
+	m_wake = Napi::ThreadSafeFunction::New(env, Napi::Function::New(env, [](const Napi::CallbackInfo &) {}), "InputStream", 0, 1);
+}
+
+void InputStream::Stop()
+{
+	if (m_timer)
+		uv_timer_stop(m_timer);
+
+	if (m_wake) {
+		m_wake.Release();
+		m_wake = Napi::ThreadSafeFunction();
+	}
+}
+
+void InputStream::Close()
+{
+	Stop();
+	if (m_timer) {
+		uv_close(reinterpret_cast<uv_handle_t *>(m_timer), [](uv_handle_t *handle) { delete reinterpret_cast<uv_timer_t *>(handle); });
+		m_timer = nullptr;
+	}
+}
+
+void InputStream::SetMotionOptions(const MotionCoalescer::Options &options)
+{
+	m_motionOptions = options;
+	if (m_motion)
+		m_motion->SetOptions(options);
+}
+
+uint32_t InputStream::Subscribe(const InputFilter &filter, Napi::Function callback)
+{
+	std::unique_ptr<Subscription> sub(new Subscription);
+	sub->id = m_nextId++;
+	sub->filter = filter;
+	sub->callback = Napi::Persistent(callback);
+	m_subscriptions.push_back(std::move(sub));
+
+	Publish();
+	return m_subscriptions.back()->id;
+}
+
+bool InputStream::Unsubscribe(uint32_t id)
+{
+	for (size_t i = 0; i < m_subscriptions.size(); i++) {
+		if (m_subscriptions[i]->id == id) {
+			m_subscriptions.erase(m_subscriptions.begin() + i);
+			Publish();
+			return true;
+		}
+	}
+	return false;
+}
+
+void InputStream::Publish()
+{
+	if (m_subscriptions.empty()) {
+		m_filter.Disable();
+		return;
+	}
+
+	InputFilter all = m_subscriptions[0]->filter;
+	for (size_t i = 1; i < m_subscriptions.size(); i++)
+		all.Merge(m_subscriptions[i]->filter);
+	m_filter.Publish(all);
+}
+
+void InputStream::Push(InputEvent event)
+{
+	if (m_recorder.Recording())
+		m_recorder.Append(event, NowNs());
+
+	if (!m_filter.Matches(event))
+		return;
+
+	event.time = NowMs();
+	if (event.type == InputType::MouseMoved || event.type == InputType::MouseDragged)
+		m_motion->Offer(event);
+	else
+		m_ring->Push(event);
+	Wake();
+}
+
+void InputStream::Wake()
+{
+	if (!m_wakePending.exchange(true, std::memory_order_acq_rel))
+		m_wake.NonBlockingCall([this](Napi::Env env, Napi::Function) { Drain(env); });
+}
+
+void InputStream::OnTimer(uv_timer_t *timer)
+{
+	// Not a JS callback context, hand over to the TSFN.
+	InputStream *stream = static_cast<InputStream *>(timer->data);
+	if (stream->m_wake)
+		stream->Wake();
+}
+
+void InputStream::Append(const InputEvent &event)
+{
+	for (std::unique_ptr<Subscription> &sub : m_subscriptions) {
+		if (!sub->filter.Matches(event))
+			continue;
+		sub->batch.push_back((int32_t)event.type);
+		sub->batch.push_back(event.code);
+		sub->batch.push_back(event.x);
+		sub->batch.push_back(event.y);
+		sub->batch.push_back((int32_t)(event.time & 0x7FFFFFFF));
+	}
+}
+
+void InputStream::Drain(Napi::Env env)
+{
+	m_wakePending.store(false, std::memory_order_release);
+
+	InputEvent event;
+	if (m_motion) {
+		uint32_t now = NowMs();
+		if (m_motion->Take(now, event))
+			Append(event);
+		else if (m_motion->Pending() && m_wake)
+			uv_timer_start(m_timer, OnTimer, m_motion->Due(now), 0);
+	}
+
+	// At most one ring's worth per turn, the rest goes with the next wake-up.
+	for (size_t n = m_ring ? m_ring->Capacity() : 0; n > 0 && m_ring->Pop(event); n--)
+		Append(event);
+	if (m_ring && m_ring->Size() > 0 && m_wake)
+		Wake();
+
+	// Callbacks may subscribe or unsubscribe, so look each one up again.
+	std::vector<uint32_t> ids;
+	for (std::unique_ptr<Subscription> &sub : m_subscriptions) {
+		if (!sub->batch.empty())
+			ids.push_back(sub->id);
+	}
+
+	for (uint32_t id : ids) {
+		for (size_t i = 0; i < m_subscriptions.size(); i++) {
+			Subscription &sub = *m_subscriptions[i];
+			if (sub.id != id)
+				continue;
+
+			Napi::Int32Array records = Napi::Int32Array::New(env, sub.batch.size());
+			memcpy(records.Data(), sub.batch.data(), sub.batch.size() * sizeof(int32_t));
+			sub.batch.clear();
+
+			try {
+				sub.callback.Call({records});
+			} catch (...) {
+				// The other subscribers' batches go out on the next turn.
+				if (m_wake)
+					Wake();
+				throw;
+			}
+			break;
+		}
+	}
+}
+
+static bool ParseType(const std::string &name, InputType &type)
+{
+	static const struct {
+		const char *name;
+		InputType type;
+	} types[] = {
+		{"keydown", InputType::KeyDown},
+		{"keyup", InputType::KeyUp},
+		{"keytyped", InputType::KeyTyped},
+		{"mousedown", InputType::MousePressed},
+		{"mouseup", InputType::MouseReleased},
+		{"mousemove", InputType::MouseMoved},
+		{"mousedrag", InputType::MouseDragged},
+		{"wheel", InputType::MouseWheel},
+	};
+
+	for (const auto &entry : types) {
+		if (name == entry.name) {
+			type = entry.type;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseKey(Napi::Value value, keycode_t &key)
+{
+	if (value.IsNumber()) {
+		uint32_t code = value.ToNumber().Uint32Value();
+		key = (keycode_t)code;
+		return code <= 0xFFFF;
+	}
+	return value.IsString() && g_KeyNames.Find(value.ToString().Utf8Value(), key);
+}
+
+Napi::Value SubscribeJS(const Napi::CallbackInfo &info)
+{
+	/* interface ISubscribeOptions {
+	 *   types?: ('keydown' | 'keyup' | 'keytyped' | 'mousedown' | 'mouseup' |
+	 *            'mousemove' | 'mousedrag' | 'wheel')[];
+	 *   keyRanges?: [string | number, string | number][]; // inclusive
+	 *   buttons?: number[]; // 1 left, 2 right, 3 middle, 4-5 extra
+	 * }
+	 * subscribe(options, (records: Int32Array) => void): number, records
+	 * holds [type, code, x, y, timestamp] tuples. Returns the subscription
+	 * id, or -1 if the options are invalid.
+	 */
+	Napi::Env env = info.Env();
+	if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction())
+		return Napi::Number::New(env, -1);
+
+	Napi::Object options = info[0].ToObject();
+	InputFilter filter;
+
+	if (options.Has("types")) {
+		Napi::Value value = options.Get("types");
+		if (!value.IsArray())
+			return Napi::Number::New(env, -1);
+		Napi::Array types = value.As<Napi::Array>();
+		for (uint32_t i = 0; i < types.Length(); i++) {
+			InputType type;
+			if (!ParseType(types.Get(i).ToString().Utf8Value(), type))
+				return Napi::Number::New(env, -1);
+			filter.AddType(type);
+		}
+	}
+
+	if (options.Has("keyRanges")) {
+		Napi::Value value = options.Get("keyRanges");
+		if (!value.IsArray())
+			return Napi::Number::New(env, -1);
+		Napi::Array ranges = value.As<Napi::Array>();
+		for (uint32_t i = 0; i < ranges.Length(); i++) {
+			if (!ranges.Get(i).IsArray())
+				return Napi::Number::New(env, -1);
+			Napi::Array range = ranges.Get(i).As<Napi::Array>();
+			keycode_t first, last;
+			if (range.Length() != 2 || !ParseKey(range.Get((uint32_t)0), first) || !ParseKey(range.Get(1), last) || first > last)
+				return Napi::Number::New(env, -1);
+			filter.AddKeyRange(first, last);
+		}
+	}
+
+	if (options.Has("buttons")) {
+		Napi::Value value = options.Get("buttons");
+		if (!value.IsArray())
+			return Napi::Number::New(env, -1);
+		Napi::Array buttons = value.As<Napi::Array>();
+		for (uint32_t i = 0; i < buttons.Length(); i++) {
+			uint32_t button = buttons.Get(i).ToNumber().Uint32Value();
+			if (button < 1 || button > 31)
+				return Napi::Number::New(env, -1);
+			filter.AddButton((uint16_t)button);
+		}
+	}
+
+	uint32_t id = GetInputStream(env).Subscribe(filter, info[1].As<Napi::Function>());
+	GetHookClient(env).Update();
+	return Napi::Number::New(env, id);
+}
+
+Napi::Value UnsubscribeJS(const Napi::CallbackInfo &info)
+{
+	if (info.Length() < 1 || !info[0].IsNumber())
+		return Napi::Boolean::New(info.Env(), false);
+
+	bool removed = GetInputStream(info.Env()).Unsubscribe(info[0].ToNumber().Uint32Value());
+	GetHookClient(info.Env()).Update();
+	return Napi::Boolean::New(info.Env(), removed);
+}
+
+Napi::Value SetMouseMoveOptionsJS(const Napi::CallbackInfo &info)
+{
+	/* interface IMouseMoveOptions {
+	 *   maxRate?: number; // updates per second, 0 for one per event loop turn
+	 *   deltas?: boolean; // x, y of moves is the motion since the last one
+	 * }
+	 */
+	if (info.Length() < 1 || !info[0].IsObject())
+		return Napi::Boolean::New(info.Env(), false);
+
+	Napi::Object options = info[0].ToObject();
+	MotionCoalescer::Options parsed;
+
+	if (options.Has("maxRate")) {
+		double rate = options.Get("maxRate").ToNumber().DoubleValue();
+		if (!(rate >= 0 && rate <= 1000))
+			return Napi::Boolean::New(info.Env(), false);
+		parsed.maxRate = (uint32_t)rate;
+	}
+	if (options.Has("deltas"))
+		parsed.deltas = options.Get("deltas").ToBoolean().Value();
+
+	GetInputStream(info.Env()).SetMotionOptions(parsed);
+	return Napi::Boolean::New(info.Env(), true);
+}
+
+Napi::Value StartRecordingJS(const Napi::CallbackInfo &info)
+{
+	if (info.Length() < 1 || !info[0].IsString())
+		return Napi::Boolean::New(info.Env(), false);
+
+	bool started = GetInputStream(info.Env()).Recorder().Start(info[0].ToString().Utf8Value());
+	// A lazy hook records nothing until it is armed.
+	GetHookClient(info.Env()).Update();
+	return Napi::Boolean::New(info.Env(), started);
+}
+
+Napi::Value StopRecordingJS(const Napi::CallbackInfo &info)
+{
+	Napi::Env env = info.Env();
+	InputRecorder &recorder = GetInputStream(env).Recorder();
+
+	Napi::Object result = Napi::Object::New(env);
+	uint64_t dropped = recorder.Dropped();
+	result.Set("records", Napi::Number::New(env, (double)recorder.Stop()));
+	result.Set("dropped", Napi::Number::New(env, (double)dropped));
+	GetHookClient(env).Update();
+	return result;
+}
+
+Napi::Value ReadRecordingJS(const Napi::CallbackInfo &info)
+{
+	/* interface IRecording {
+	 *   platform: 'windows' | 'macos' | 'linux' | 'unknown';
+	 *   timeNs: Float64Array; // per record, since the first one
+	 *   events: Int32Array;   // (type, code, x, y) per record
+	 * }
+	 */
+	Napi::Env env = info.Env();
+	TraceReader reader;
+	if (info.Length() < 1 || !info[0].IsString() || !reader.Open(info[0].ToString().Utf8Value()))
+		return env.Null();
+
+	static const char *platforms[] = {"unknown", "windows", "macos", "linux"};
+	uint32_t platform = (uint32_t)reader.Platform();
+
+	const std::vector<TraceRecord> &records = reader.Records();
+	Napi::Float64Array times = Napi::Float64Array::New(env, records.size());
+	Napi::Int32Array events = Napi::Int32Array::New(env, records.size() * 4);
+	for (size_t i = 0; i < records.size(); i++) {
+		const InputEvent &event = records[i].event;
+		times[i] = (double)records[i].timeNs;
+		events[i * 4] = (int32_t)event.type;
+		events[i * 4 + 1] = event.code;
+		events[i * 4 + 2] = event.x;
+		events[i * 4 + 3] = event.y;
+	}
+
+	Napi::Object result = Napi::Object::New(env);
+	result.Set("platform", platforms[platform < 4 ? platform : 0]);
+	result.Set("timeNs", times);
+	result.Set("events", events);
+	return result;
+}
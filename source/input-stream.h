@@ -0,0 +1,104 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "event-queue.h"
+#include "input-filter.h"
+#include "input-recorder.h"
+#include "motion-coalescer.h"
+
+#include <napi.h>
+#include <uv.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Raw input for subscribe(). The hook thread checks each event against the
+// union of all subscription filters and queues only the ones somebody wants,
+// so with no subscribers a mouse move costs one relaxed load. The JS thread
+// then splits a drain among the subscribers and calls each once with an
+// Int32Array of (type, code, x, y, timestamp) records.
+//
+// Moves and drags skip the queue. They go through a MotionCoalescer, so each
+// drain carries at most the latest one, and with a maximum rate set a timer
+// on the JS thread's loop sends the last pending one once it's due.
+//
+// Push also hands every event, filtered or not, to the recorder, which costs
+// nothing more while it's not recording.
+//
+// Everything but Push runs on the JS thread.
+class InputStream {
+public:
+	// relativeMotion: the backend reports motion instead of pointer positions.
+	void Start(Napi::Env env, bool relativeMotion = false);
+	void Stop();
+	// Frees the loop's handles, when the environment goes away.
+	void Close();
+
+	void SetMotionOptions(const MotionCoalescer::Options &options);
+
+	uint32_t Subscribe(const InputFilter &filter, Napi::Function callback);
+	bool Unsubscribe(uint32_t id);
+
+	uint64_t Dropped() const { return m_dropped + (m_ring ? m_ring->Dropped() : 0); };
+	size_t Subscriptions() const { return m_subscriptions.size(); };
+
+	InputRecorder &Recorder() { return m_recorder; };
+	bool Recording() const { return m_recorder.Recording(); };
+
+	// Hook thread only.
+	void Push(InputEvent event);
+
+private:
+	struct Subscription {
+		uint32_t id;
+		InputFilter filter;
+		Napi::FunctionReference callback;
+		std::vector<int32_t> batch;
+	};
+
+	void Publish();
+	void Append(const InputEvent &event);
+	void Drain(Napi::Env env);
+	void Wake();
+	static void OnTimer(uv_timer_t *timer);
+
+	std::vector<std::unique_ptr<Subscription>> m_subscriptions;
+	uint32_t m_nextId = 1;
+	SharedInputFilter m_filter;
+
+	std::unique_ptr<SpscRing<InputEvent>> m_ring;
+	std::unique_ptr<MotionCoalescer> m_motion;
+	MotionCoalescer::Options m_motionOptions;
+	uv_timer_t *m_timer = nullptr; // freed once closed
+	Napi::ThreadSafeFunction m_wake;
+	std::atomic<bool> m_wakePending{false};
+	uint64_t m_dropped = 0; // by rings of earlier runs
+
+	InputRecorder m_recorder;
+};
+
+// The calling environment's, see HookClient.
+InputStream &GetInputStream(Napi::Env env);
+
+Napi::Value SubscribeJS(const Napi::CallbackInfo &info);
+Napi::Value UnsubscribeJS(const Napi::CallbackInfo &info);
+Napi::Value SetMouseMoveOptionsJS(const Napi::CallbackInfo &info);
+Napi::Value StartRecordingJS(const Napi::CallbackInfo &info);
+Napi::Value StopRecordingJS(const Napi::CallbackInfo &info);
+Napi::Value ReadRecordingJS(const Napi::CallbackInfo &info);
@@ -0,0 +1,93 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "input-trace.h"
+
+#include <stddef.h>
+#include <string.h>
+
+bool TraceWriter::Open(const std::string &path, TracePlatform platform)
+{
+	Close();
+	m_file = fopen(path.c_str(), "wb");
+	if (!m_file)
+		return false;
+
+	TraceHeader header = {};
+	memcpy(header.magic, TraceMagic, sizeof(header.magic));
+	header.version = TraceVersion;
+	header.recordSize = sizeof(TraceRecord);
+	header.platform = (uint32_t)platform;
+	header.count = TraceCountUnknown;
+	m_count = 0;
+	return fwrite(&header, sizeof(header), 1, m_file) == 1;
+}
+
+bool TraceWriter::Append(uint64_t nowNs, const InputEvent &event)
+{
+	if (!m_file)
+		return false;
+	if (m_count == 0)
+		m_startNs = nowNs;
+
+	TraceRecord record = {nowNs - m_startNs, event};
+	if (fwrite(&record, sizeof(record), 1, m_file) != 1)
+		return false;
+	m_count++;
+	return true;
+}
+
+bool TraceWriter::Close()
+{
+	if (!m_file)
+		return false;
+
+	bool ok = fseek(m_file, offsetof(TraceHeader, count), SEEK_SET) == 0 && fwrite(&m_count, sizeof(m_count), 1, m_file) == 1;
+	ok = fclose(m_file) == 0 && ok;
+	m_file = nullptr;
+	return ok;
+}
+
+bool TraceReader::Open(const std::string &path)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return Fail("can't open " + path);
+
+	bool header = fread(&m_header, sizeof(m_header), 1, file) == 1;
+	if (!header || memcmp(m_header.magic, TraceMagic, sizeof(TraceMagic)) != 0) {
+		fclose(file);
+		return Fail("not an input trace");
+	}
+	if (m_header.version < 1 || m_header.version > TraceVersion || m_header.recordSize != sizeof(TraceRecord)) {
+		fclose(file);
+		return Fail("unsupported trace version");
+	}
+	uint64_t count = m_header.count;
+	if (m_header.version == 1 && count == 0)
+		count = TraceCountUnknown;
+
+	m_records.clear();
+	TraceRecord record;
+	while ((count == TraceCountUnknown || m_records.size() < count) && fread(&record, sizeof(record), 1, file) == 1)
+		m_records.push_back(record);
+	fclose(file);
+
+	m_error.clear();
+	return true;
+}
@@ -0,0 +1,105 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "input-filter.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Binary input trace: a header followed by fixed-size records of raw input
+// events, as the hook delivered them, with nanosecond timestamps. Key codes
+// are the platform's, so a trace only replays on the platform it was recorded
+// on. All fields are little-endian.
+enum class TracePlatform : uint32_t { Unknown, Windows, MacOS, Linux };
+
+#if defined(_WIN32)
+static const TracePlatform CurrentTracePlatform = TracePlatform::Windows;
+#elif defined(__APPLE__)
+static const TracePlatform CurrentTracePlatform = TracePlatform::MacOS;
+#else
+static const TracePlatform CurrentTracePlatform = TracePlatform::Linux;
+#endif
+
+struct TraceHeader {
+	char magic[8];       // "UIOTRACE"
+	uint32_t version;    // TraceVersion
+	uint32_t recordSize; // sizeof(TraceRecord)
+	uint32_t platform;   // TracePlatform
+	uint32_t reserved;
+	uint64_t count; // records, TraceCountUnknown until a TraceWriter finishes
+};
+
+struct TraceRecord {
+	uint64_t timeNs; // since the recording started
+	InputEvent event;
+};
+
+static const char TraceMagic[8] = {'U', 'I', 'O', 'T', 'R', 'A', 'C', 'E'};
+// Version 1 used a count of 0 for unknown, which can't be told from an empty
+// InputRecorder file.
+static const uint32_t TraceVersion = 2;
+static const uint64_t TraceCountUnknown = ~(uint64_t)0;
+
+static_assert(sizeof(TraceHeader) == 32 && sizeof(TraceRecord) == 24, "the trace layout is a file format");
+
+// Buffered writer, for tools that record from a thread that may block.
+class TraceWriter {
+public:
+	~TraceWriter() { Close(); };
+
+	bool Open(const std::string &path, TracePlatform platform = CurrentTracePlatform);
+	// The first record's time becomes the start of the trace.
+	bool Append(uint64_t nowNs, const InputEvent &event);
+	// Writes the final count into the header.
+	bool Close();
+
+	uint64_t Count() const { return m_count; };
+
+private:
+	FILE *m_file = nullptr;
+	uint64_t m_startNs = 0;
+	uint64_t m_count = 0;
+};
+
+// Reads a whole trace into memory. The header count is authoritative: an
+// InputRecorder file holds preallocated records past it. A TraceWriter that
+// was killed leaves TraceCountUnknown, and its trace is read up to its last
+// whole record.
+class TraceReader {
+public:
+	bool Open(const std::string &path);
+
+	const std::string &Error() const { return m_error; };
+	TracePlatform Platform() const { return (TracePlatform)m_header.platform; };
+	const std::vector<TraceRecord> &Records() const { return m_records; };
+
+private:
+	bool Fail(const std::string &error)
+	{
+		m_error = error;
+		m_records.clear();
+		return false;
+	};
+
+	TraceHeader m_header = {};
+	std::vector<TraceRecord> m_records;
+	std::string m_error;
+};
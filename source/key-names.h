@@ -0,0 +1,212 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "key-state.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include "uiohook.h"
+#else
+#include <linux/input-event-codes.h>
+#endif
+
+#define NO_KEY 0
+
+// The OS only reports sided modifiers (apart from the Windows VK_SHIFT family),
+// the generic ones get codes no real key uses.
+#if defined(__APPLE__)
+enum : keycode_t {
+	VC_GENERIC_SHIFT = 0xFFF0,
+	VC_GENERIC_CONTROL,
+	VC_GENERIC_ALT,
+	VC_GENERIC_META,
+};
+#elif !defined(_WIN32)
+enum : keycode_t {
+	KEY_GENERIC_SHIFT = KEY_CNT,
+	KEY_GENERIC_CONTROL,
+	KEY_GENERIC_ALT,
+	KEY_GENERIC_META,
+};
+#endif
+
+struct KeyName {
+	const char *name;
+	keycode_t code;
+};
+
+// Perfect hash over a fixed set of names, built by the compiler with the
+// hash-and-displace scheme: the name's hash picks a bucket, and the bucket's
+// seed remixes it so every name lands on its own slot. A lookup is one pass
+// over the name, two integer mixes and one string compare, with no allocation
+// and nothing to build at startup. Names mapped to NO_KEY are left out.
+template<size_t N> class KeyNameTable {
+public:
+	constexpr explicit KeyNameTable(const KeyName (&names)[N])
+	{
+		// Group the names by bucket.
+		uint32_t hashes[N] = {};
+		size_t bucketOf[N] = {};
+		size_t start[Buckets + 1] = {};
+		for (size_t i = 0; i < N; i++) {
+			hashes[i] = Hash(names[i].name);
+			bucketOf[i] = Mix(hashes[i], 0) & (Buckets - 1);
+			start[bucketOf[i] + 1]++;
+		}
+		size_t largest = 0;
+		for (size_t b = 0; b < Buckets; b++) {
+			largest = start[b + 1] > largest ? start[b + 1] : largest;
+			start[b + 1] += start[b];
+		}
+		size_t order[N] = {};
+		size_t fill[Buckets] = {};
+		for (size_t i = 0; i < N; i++)
+			order[start[bucketOf[i]] + fill[bucketOf[i]]++] = i;
+
+		// Place the crowded buckets first while most slots are free.
+		bool used[Slots] = {};
+		size_t scratch[N] = {};
+		for (size_t size = largest; size > 0; size--) {
+			for (size_t b = 0; b < Buckets; b++) {
+				if (start[b + 1] - start[b] != size)
+					continue;
+				if (!PlaceBucket(names, hashes, order + start[b], size, used, scratch, m_seeds[b]))
+					return;
+			}
+		}
+		m_valid = true;
+	};
+
+	// False if the names could not be hashed apart, i.e. one is listed twice.
+	constexpr bool Valid() const { return m_valid; };
+
+	constexpr bool Find(std::string_view name, keycode_t &code) const
+	{
+		uint32_t h = Hash(name);
+		const KeyName &entry = m_slots[Mix(h, m_seeds[Mix(h, 0) & (Buckets - 1)]) & (Slots - 1)];
+		if (!entry.name || name != entry.name)
+			return false;
+
+		code = entry.code;
+		return true;
+	};
+
+private:
+	static constexpr size_t Pow2(size_t n)
+	{
+		size_t p = 1;
+		while (p < n)
+			p <<= 1;
+		return p;
+	};
+
+	static constexpr size_t Buckets = Pow2(N / 4 + 1);
+	static constexpr size_t Slots = Pow2(N * 2);
+	static constexpr uint32_t MaxSeed = 1024;
+
+	// FNV-1a over the name once, then a cheap seeded finalizer per probe.
+	static constexpr uint32_t Hash(std::string_view s)
+	{
+		uint32_t h = 2166136261u;
+		for (char c : s)
+			h = (h ^ (uint8_t)c) * 16777619u;
+		return h;
+	};
+
+	// Same hash, without measuring the string first; keeps the build cheap
+	// enough for the compilers' constexpr step limits.
+	static constexpr uint32_t Hash(const char *s)
+	{
+		uint32_t h = 2166136261u;
+		for (; *s; s++)
+			h = (h ^ (uint8_t)*s) * 16777619u;
+		return h;
+	};
+
+	static constexpr uint32_t Mix(uint32_t h, uint32_t seed)
+	{
+		h ^= seed * 0x9E3779B9u;
+		h ^= h >> 15;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		return h;
+	};
+
+	constexpr bool PlaceBucket(const KeyName (&names)[N], const uint32_t (&hashes)[N], const size_t *members, size_t count, bool (&used)[Slots], size_t *slots, uint32_t &seed)
+	{
+		for (seed = 1; seed < MaxSeed; seed++) {
+			size_t placed = 0;
+			for (; placed < count; placed++) {
+				size_t slot = Mix(hashes[members[placed]], seed) & (Slots - 1);
+				bool taken = used[slot];
+				for (size_t j = 0; j < placed; j++)
+					taken = taken || slots[j] == slot;
+				if (taken)
+					break;
+				slots[placed] = slot;
+			}
+			if (placed < count)
+				continue;
+
+			for (size_t i = 0; i < count; i++) {
+				used[slots[i]] = true;
+				if (names[members[i]].code != NO_KEY)
+					m_slots[slots[i]] = names[members[i]];
+			}
+			return true;
+		}
+		return false;
+	};
+
+	uint32_t m_seeds[Buckets] = {};
+	KeyName m_slots[Slots] = {};
+	bool m_valid = false;
+};
+
+// Key names with this platform's codes, see key-names.def.
+#if defined(_WIN32)
+#define KEY(name, win, mac, lin) {name, win},
+#elif defined(__APPLE__)
+#define KEY(name, win, mac, lin) {name, mac},
+#else
+#define KEY(name, win, mac, lin) {name, lin},
+#endif
+constexpr KeyName g_KeyNameSpec[] = {
+#include "key-names.def"
+};
+#undef KEY
+
+constexpr KeyNameTable<sizeof(g_KeyNameSpec) / sizeof(g_KeyNameSpec[0])> g_KeyNames(g_KeyNameSpec);
+static_assert(g_KeyNames.Valid(), "key-names.def lists a name twice");
+
+// The first name key-names.def gives a code, nullptr if it has none. A linear
+// scan, meant for the few keys held at once.
+inline const char *KeyNameOf(keycode_t code)
+{
+	for (const KeyName &name : g_KeyNameSpec) {
+		if (name.code == code && code != NO_KEY)
+			return name.name;
+	}
+	return nullptr;
+}
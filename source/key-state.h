@@ -0,0 +1,132 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <initializer_list>
+
+// Platform key code (virtual key on Windows, uiohook VC_* on macOS, evdev
+// KEY_* on Linux).
+typedef uint16_t keycode_t;
+
+struct KeyEvent {
+	keycode_t key;
+	bool down;
+};
+
+enum : uint8_t {
+	MOD_SHIFT = 1 << 0,
+	MOD_CTRL = 1 << 1,
+	MOD_ALT = 1 << 2,
+	MOD_META = 1 << 3,
+	MOD_ALL = MOD_SHIFT | MOD_CTRL | MOD_ALT | MOD_META,
+};
+
+// Describes one modifier key of a platform. A generic key ("Shift" as
+// opposed to "ShiftLeft") is never reported by the OS, it is held while any
+// other key of the same modifier is.
+struct ModifierKey {
+	keycode_t key;
+	uint8_t mask;
+	bool generic;
+};
+
+// Pressed keys as a fixed 64K bit bitmap plus the held modifiers as a packed
+// mask, so a chord check is one mask compare and one bit test.
+class KeyState {
+public:
+	static const size_t MaxModifierKeys = 16;
+
+	KeyState() { Reset(); };
+	explicit KeyState(std::initializer_list<ModifierKey> modifiers) : KeyState()
+	{
+		for (const ModifierKey &modifier : modifiers) {
+			if (m_modifierCount < MaxModifierKeys)
+				m_modifierKeys[m_modifierCount++] = modifier;
+		}
+	};
+
+	void Reset()
+	{
+		memset(m_bits, 0, sizeof(m_bits));
+		m_modifiers = 0;
+	};
+
+	bool IsDown(keycode_t key) const { return (m_bits[key >> 6] >> (key & 63)) & 1; };
+	uint8_t Modifiers() const { return m_modifiers; };
+
+	// The modifier bit a key contributes, 0 for ordinary keys.
+	uint8_t ModifierOf(keycode_t key) const
+	{
+		for (size_t i = 0; i < m_modifierCount; i++) {
+			if (m_modifierKeys[i].key == key)
+				return m_modifierKeys[i].mask;
+		}
+		return 0;
+	};
+
+	// Applies a raw transition. Writes the resulting edges (the key itself
+	// and a generic modifier that changed with it) to edges and returns
+	// their count, 0 for repeats.
+	size_t Update(const KeyEvent &event, KeyEvent edges[2])
+	{
+		if (IsDown(event.key) == event.down)
+			return 0;
+
+		Set(event.key, event.down);
+		edges[0] = event;
+
+		uint8_t mask = ModifierOf(event.key);
+		if (!mask)
+			return 1;
+
+		uint8_t modifiers = 0;
+		for (size_t i = 0; i < m_modifierCount; i++) {
+			if (!m_modifierKeys[i].generic && IsDown(m_modifierKeys[i].key))
+				modifiers |= m_modifierKeys[i].mask;
+		}
+		m_modifiers = modifiers;
+
+		for (size_t i = 0; i < m_modifierCount; i++) {
+			const ModifierKey &generic = m_modifierKeys[i];
+			if (generic.generic && generic.mask == mask && IsDown(generic.key) != ((modifiers & mask) != 0)) {
+				Set(generic.key, (modifiers & mask) != 0);
+				edges[1] = {generic.key, (modifiers & mask) != 0};
+				return 2;
+			}
+		}
+		return 1;
+	};
+
+private:
+	void Set(keycode_t key, bool down)
+	{
+		uint64_t bit = 1ULL << (key & 63);
+		if (down)
+			m_bits[key >> 6] |= bit;
+		else
+			m_bits[key >> 6] &= ~bit;
+	};
+
+	uint64_t m_bits[0x10000 / 64];
+	uint8_t m_modifiers;
+
+	ModifierKey m_modifierKeys[MaxModifierKeys];
+	size_t m_modifierCount = 0;
+};
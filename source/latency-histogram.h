@@ -0,0 +1,121 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Log-linear histogram of nanosecond durations, HDR style: every power of two
+// is split into SubBuckets equal buckets, so a value is reported within 1/16
+// of itself however large it is, in a fixed 8 KB. Recording is two relaxed
+// atomic operations and never blocks or allocates, so the hook thread can
+// record while another thread reads; a read taken meanwhile may be off by the
+// values still coming in.
+class LatencyHistogram {
+public:
+	static const uint32_t SubBits = 4;
+	static const uint32_t SubBuckets = 1 << SubBits;
+	static const uint32_t Buckets = (64 - SubBits + 1) * SubBuckets;
+
+	LatencyHistogram() { Reset(); };
+
+	void Record(uint64_t ns)
+	{
+		m_counts[Index(ns)].fetch_add(1, std::memory_order_relaxed);
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+		}
+	};
+
+	void Reset()
+	{
+		for (std::atomic<uint64_t> &count : m_counts)
+			count.store(0, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	};
+
+	uint64_t Count() const
+	{
+		uint64_t total = 0;
+		for (const std::atomic<uint64_t> &count : m_counts)
+			total += count.load(std::memory_order_relaxed);
+		return total;
+	};
+
+	uint64_t Max() const { return m_max.load(std::memory_order_relaxed); };
+
+	// The value at or below which a fraction q of the recorded values lie,
+	// rounded up to the top of its bucket but never above Max. 0 if empty.
+	uint64_t Percentile(double q) const
+	{
+		uint64_t total = Count();
+		if (total == 0)
+			return 0;
+
+		uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+		if (rank < 1)
+			rank = 1;
+
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < Buckets; i++) {
+			seen += m_counts[i].load(std::memory_order_relaxed);
+			if (seen >= rank) {
+				uint64_t top = Highest(i);
+				return top < Max() ? top : Max();
+			}
+		}
+		return Max();
+	};
+
+	// Bucket math, public for tests.
+	static uint32_t Index(uint64_t ns)
+	{
+		if (ns < SubBuckets)
+			return (uint32_t)ns;
+		uint32_t exponent = HighestBit(ns);
+		return (exponent - SubBits + 1) * SubBuckets + (uint32_t)((ns >> (exponent - SubBits)) & (SubBuckets - 1));
+	};
+	static uint64_t Highest(uint32_t index)
+	{
+		if (index < SubBuckets)
+			return index;
+		uint32_t shift = index / SubBuckets - 1;
+		uint64_t low = (uint64_t)(SubBuckets + index % SubBuckets) << shift;
+		return low + ((uint64_t)1 << shift) - 1;
+	};
+
+private:
+	static uint32_t HighestBit(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long bit;
+		_BitScanReverse64(&bit, value);
+		return (uint32_t)bit;
+#else
+		return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+	};
+
+	std::atomic<uint64_t> m_counts[Buckets];
+	std::atomic<uint64_t> m_max;
+};
@@ -14,14 +14,41 @@
 
 #include <napi.h>
 #include "hook.h"
+#include "hook-client.h"
 
 void Init(Napi::Env env, Napi::Object exports)
 {
+	// Runs once per environment that loads the module.
+	env.SetInstanceData(new HookClient(env));
+
 	exports.Set(Napi::String::New(env, "startHook"), Napi::Function::New(env, StartHotkeyThreadJS));
 	exports.Set(Napi::String::New(env, "stopHook"), Napi::Function::New(env, StopHotkeyThreadJS));
+	exports.Set(Napi::String::New(env, "startHookAsync"), Napi::Function::New(env, StartHookAsyncJS));
+	exports.Set(Napi::String::New(env, "stopHookAsync"), Napi::Function::New(env, StopHookAsyncJS));
 	exports.Set(Napi::String::New(env, "registerCallback"), Napi::Function::New(env, RegisterHotkeyJS));
 	exports.Set(Napi::String::New(env, "unregisterCallback"), Napi::Function::New(env, UnregisterHotkeyJS));
 	exports.Set(Napi::String::New(env, "unregisterAllCallbacks"), Napi::Function::New(env, UnregisterHotkeysJS));
+	exports.Set(Napi::String::New(env, "registerCallbacks"), Napi::Function::New(env, RegisterCallbacksJS));
+	exports.Set(Napi::String::New(env, "replaceAllCallbacks"), Napi::Function::New(env, ReplaceAllCallbacksJS));
+	exports.Set(Napi::String::New(env, "setEventQueueOptions"), Napi::Function::New(env, SetEventQueueOptionsJS));
+	exports.Set(Napi::String::New(env, "getDroppedEventCount"), Napi::Function::New(env, GetDroppedEventCountJS));
+	exports.Set(Napi::String::New(env, "getStats"), Napi::Function::New(env, GetStatsJS));
+	exports.Set(Napi::String::New(env, "setBatchCallback"), Napi::Function::New(env, SetBatchCallbackJS));
+	exports.Set(Napi::String::New(env, "getBindingId"), Napi::Function::New(env, GetBindingIdJS));
+	exports.Set(Napi::String::New(env, "registerSequence"), Napi::Function::New(env, RegisterSequenceJS));
+	exports.Set(Napi::String::New(env, "unregisterSequence"), Napi::Function::New(env, UnregisterSequenceJS));
+	exports.Set(Napi::String::New(env, "setCaptureThreadOptions"), Napi::Function::New(env, SetCaptureThreadOptionsJS));
+	exports.Set(Napi::String::New(env, "getCaptureThreadOptions"), Napi::Function::New(env, GetCaptureThreadOptionsJS));
+	exports.Set(Napi::String::New(env, "isKeyDown"), Napi::Function::New(env, IsKeyDownJS));
+	exports.Set(Napi::String::New(env, "getPressedKeys"), Napi::Function::New(env, GetPressedKeysJS));
+	exports.Set(Napi::String::New(env, "registerGesture"), Napi::Function::New(env, RegisterGestureJS));
+	exports.Set(Napi::String::New(env, "unregisterGesture"), Napi::Function::New(env, UnregisterGestureJS));
+	exports.Set(Napi::String::New(env, "subscribe"), Napi::Function::New(env, SubscribeJS));
+	exports.Set(Napi::String::New(env, "unsubscribe"), Napi::Function::New(env, UnsubscribeJS));
+	exports.Set(Napi::String::New(env, "setMouseMoveOptions"), Napi::Function::New(env, SetMouseMoveOptionsJS));
+	exports.Set(Napi::String::New(env, "startRecording"), Napi::Function::New(env, StartRecordingJS));
+	exports.Set(Napi::String::New(env, "stopRecording"), Napi::Function::New(env, StopRecordingJS));
+	exports.Set(Napi::String::New(env, "readRecording"), Napi::Function::New(env, ReadRecordingJS));
 }
 
 Napi::Object main_node(Napi::Env env, Napi::Object exports)
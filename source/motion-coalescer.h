@@ -0,0 +1,132 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "input-filter.h"
+
+#include <stdint.h>
+#include <atomic>
+
+// Collapses pointer motion into a single pending update, so a 1000 Hz mouse
+// costs the consumer at most one event per turn (or per 1/maxRate seconds)
+// however fast it moves. The hook thread offers every move and drag, the
+// consumer takes the latest one once it is due. Motion in between is summed,
+// so with deltas on nothing is lost, only merged.
+//
+// One producer and one consumer thread, neither blocks. A move offered while
+// the consumer takes may show up in the next update as well; positions can
+// repeat but deltas always add up to the total motion.
+class MotionCoalescer {
+public:
+	struct Options {
+		uint32_t maxRate = 0; // updates per second, 0 for one per take
+		bool deltas = false;  // report summed motion instead of position
+	};
+
+	// relative: the source reports motion rather than positions (evdev), so
+	// updates always carry summed motion.
+	explicit MotionCoalescer(bool relative = false) : m_relative(relative){};
+
+	// Consumer thread.
+	void SetOptions(const Options &options) { m_options = options; };
+	const Options &GetOptions() const { return m_options; };
+
+	// Producer thread, event is a MouseMoved or MouseDragged.
+	void Offer(const InputEvent &event)
+	{
+		int32_t dx = event.x, dy = event.y;
+		if (!m_relative) {
+			dx = m_hasLast ? event.x - m_lastX : 0;
+			dy = m_hasLast ? event.y - m_lastY : 0;
+			m_lastX = event.x;
+			m_lastY = event.y;
+			m_hasLast = true;
+		}
+
+		m_position.store(Pack((uint32_t)event.x, (uint32_t)event.y), std::memory_order_relaxed);
+		m_meta.store(Pack((uint32_t)event.type, event.time), std::memory_order_relaxed);
+		m_dx.fetch_add(dx, std::memory_order_relaxed);
+		m_dy.fetch_add(dy, std::memory_order_relaxed);
+		m_pending.store(true, std::memory_order_release);
+	};
+
+	bool Pending() const { return m_pending.load(std::memory_order_acquire); };
+
+	// Consumer thread. Milliseconds until the pending update may be taken,
+	// 0 if it can be taken now. Only meaningful while Pending().
+	uint32_t Due(uint32_t nowMs) const
+	{
+		if (!m_options.maxRate || !m_taken)
+			return 0;
+		uint32_t interval = 1000 / m_options.maxRate;
+		uint32_t elapsed = nowMs - m_lastTake;
+		return elapsed >= interval ? 0 : interval - elapsed;
+	};
+
+	// Consumer thread. Writes the latest motion to event if one is pending
+	// and due.
+	bool Take(uint32_t nowMs, InputEvent &event)
+	{
+		if (!Pending() || Due(nowMs) > 0)
+			return false;
+
+		// Cleared before reading, so a move offered from here on sets it
+		// again instead of getting lost.
+		m_pending.exchange(false, std::memory_order_acq_rel);
+
+		uint64_t position = m_position.load(std::memory_order_relaxed);
+		uint64_t meta = m_meta.load(std::memory_order_relaxed);
+		int32_t dx = m_dx.exchange(0, std::memory_order_relaxed);
+		int32_t dy = m_dy.exchange(0, std::memory_order_relaxed);
+
+		event.type = (InputType)(meta >> 32);
+		event.reserved = 0;
+		event.code = 0;
+		event.time = (uint32_t)meta;
+		if (m_relative || m_options.deltas) {
+			event.x = dx;
+			event.y = dy;
+		} else {
+			event.x = (int32_t)(position >> 32);
+			event.y = (int32_t)position;
+		}
+
+		m_lastTake = nowMs;
+		m_taken = true;
+		return true;
+	};
+
+private:
+	static uint64_t Pack(uint32_t high, uint32_t low) { return (uint64_t)high << 32 | low; };
+
+	const bool m_relative;
+
+	// Producer only.
+	int32_t m_lastX = 0, m_lastY = 0;
+	bool m_hasLast = false;
+
+	// Consumer only.
+	Options m_options;
+	uint32_t m_lastTake = 0;
+	bool m_taken = false;
+
+	std::atomic<uint64_t> m_position{0}; // x, y
+	std::atomic<uint64_t> m_meta{0};     // type, time
+	std::atomic<int32_t> m_dx{0}, m_dy{0};
+	std::atomic<bool> m_pending{false};
+};
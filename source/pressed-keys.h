@@ -0,0 +1,137 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "key-state.h"
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+// The keys held right now, kept by one writer (the capture thread) and read
+// from any thread without a lock or a system call. The writer tracks the keys
+// in a KeyState, so repeats and generic modifiers work as for matching, and
+// mirrors every change into a bitmap of atomic words.
+//
+// A single key is one atomic load. Snapshots take every key at one instant: a
+// sequence counter, odd while the writer is changing the bitmap, makes a
+// reader retry if a change overlapped its copy. A summary word per 64 words
+// lets a snapshot skip the empty parts of the 64K bit bitmap.
+class PressedKeys {
+public:
+	explicit PressedKeys(KeyState state = KeyState()) : m_state(state) { Clear(); };
+
+	// Writer only. Applies a raw transition, repeats change nothing.
+	void Update(const KeyEvent &event)
+	{
+		KeyEvent edges[2];
+		size_t count = m_state.Update(event, edges);
+		if (count == 0)
+			return;
+
+		uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+		m_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < count; i++)
+			Mirror(edges[i].key);
+		m_modifiers.store(m_state.Modifiers(), std::memory_order_relaxed);
+		m_sequence.store(sequence + 2, std::memory_order_release);
+	};
+
+	// Writer only, or while there is none.
+	void Reset()
+	{
+		m_state.Reset();
+		uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+		m_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		Clear();
+		m_sequence.store(sequence + 2, std::memory_order_release);
+	};
+
+	// Any thread.
+	bool IsDown(keycode_t key) const { return (m_words[key >> 6].load(std::memory_order_relaxed) >> (key & 63)) & 1; };
+	uint8_t Modifiers() const { return m_modifiers.load(std::memory_order_relaxed); };
+
+	// Any thread. Replaces keys with the codes held at one instant, in
+	// ascending order.
+	void Snapshot(std::vector<keycode_t> &keys) const
+	{
+		while (true) {
+			keys.clear();
+			uint32_t before = m_sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+
+			for (size_t s = 0; s < Summaries; s++) {
+				uint64_t summary = m_summary[s].load(std::memory_order_relaxed);
+				for (; summary; summary &= summary - 1) {
+					size_t w = s * 64 + Lowest(summary);
+					for (uint64_t word = m_words[w].load(std::memory_order_relaxed); word; word &= word - 1)
+						keys.push_back((keycode_t)(w * 64 + Lowest(word)));
+				}
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (m_sequence.load(std::memory_order_relaxed) == before)
+				return;
+		}
+	};
+
+private:
+	static constexpr size_t Words = 65536 / 64;
+	static constexpr size_t Summaries = Words / 64;
+
+	static size_t Lowest(uint64_t bits)
+	{
+		size_t n = 0;
+		while (!(bits & 1)) {
+			bits >>= 1;
+			n++;
+		}
+		return n;
+	};
+
+	void Mirror(keycode_t key)
+	{
+		size_t w = key >> 6;
+		uint64_t word = m_words[w].load(std::memory_order_relaxed);
+		uint64_t bit = 1ULL << (key & 63);
+		word = m_state.IsDown(key) ? word | bit : word & ~bit;
+		m_words[w].store(word, std::memory_order_relaxed);
+
+		uint64_t summary = m_summary[w >> 6].load(std::memory_order_relaxed);
+		bit = 1ULL << (w & 63);
+		m_summary[w >> 6].store(word ? summary | bit : summary & ~bit, std::memory_order_relaxed);
+	};
+
+	void Clear()
+	{
+		for (std::atomic<uint64_t> &word : m_words)
+			word.store(0, std::memory_order_relaxed);
+		for (std::atomic<uint64_t> &summary : m_summary)
+			summary.store(0, std::memory_order_relaxed);
+		m_modifiers.store(0, std::memory_order_relaxed);
+	};
+
+	KeyState m_state; // writer only
+	std::atomic<uint32_t> m_sequence{0};
+	std::atomic<uint8_t> m_modifiers{0};
+	std::array<std::atomic<uint64_t>, Summaries> m_summary;
+	std::array<std::atomic<uint64_t>, Words> m_words;
+};
@@ -0,0 +1,119 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Read-copy-update cell for one writer thread and one reader thread. The
+// writer publishes immutable versions of T, the reader picks up the newest one
+// with a single load and never blocks, retries or frees anything.
+//
+// Retired versions are reclaimed hazard pointer style: the reader announces
+// the version it uses, and while switching the one it switches to, and the
+// writer only frees versions neither slot points at. A reader that announced
+// a version re-checks it is still the newest, so the writer can't have missed
+// the announcement when it freed it. At most the version in use and the one
+// being switched to are kept beyond the newest.
+template<class T> class RcuPointer {
+public:
+	explicit RcuPointer(std::unique_ptr<T> initial) : m_latest(initial.release())
+	{
+		m_hazard[0].store(m_latest.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_hazard[1].store(nullptr, std::memory_order_relaxed);
+	};
+	~RcuPointer()
+	{
+		delete m_latest.load(std::memory_order_relaxed);
+		for (T *retired : m_retired)
+			delete retired;
+	};
+
+	RcuPointer(const RcuPointer &) = delete;
+	RcuPointer &operator=(const RcuPointer &) = delete;
+
+	// Writer only. The newest version, valid until the next Publish.
+	const T &Latest() const { return *m_latest.load(std::memory_order_relaxed); };
+
+	// Writer only. Retires the previous version and frees what the reader is
+	// done with.
+	void Publish(std::unique_ptr<T> next)
+	{
+		m_retired.push_back(m_latest.exchange(next.release(), std::memory_order_seq_cst));
+		Reclaim();
+	};
+
+	// Writer only. Returns how many retired versions are still held back.
+	size_t Reclaim()
+	{
+		const T *inUse = m_hazard[0].load(std::memory_order_seq_cst);
+		const T *next = m_hazard[1].load(std::memory_order_seq_cst);
+
+		size_t kept = 0;
+		for (T *retired : m_retired) {
+			if (retired == inUse || retired == next)
+				m_retired[kept++] = retired;
+			else
+				delete retired;
+		}
+		m_retired.resize(kept);
+		return kept;
+	};
+
+	// Reader only. The version in use, valid until the next Adopt.
+	const T &Current() const { return *m_hazard[0].load(std::memory_order_relaxed); };
+
+	// Reader only. Returns the newest version if it isn't the current one,
+	// else null. It stays valid, along with the current one, until Adopt.
+	const T *Peek()
+	{
+		const T *current = m_hazard[0].load(std::memory_order_relaxed);
+		const T *latest = m_latest.load(std::memory_order_acquire);
+		if (latest == current)
+			return nullptr;
+
+		// Announce, then make sure it wasn't retired before the writer could
+		// see the announcement.
+		for (;;) {
+			m_hazard[1].store(latest, std::memory_order_seq_cst);
+			const T *again = m_latest.load(std::memory_order_seq_cst);
+			if (again == latest)
+				return latest;
+			if (again == current) {
+				m_hazard[1].store(nullptr, std::memory_order_release);
+				return nullptr;
+			}
+			latest = again;
+		}
+	};
+
+	// Reader only. Switches to what Peek returned, the old version may be
+	// freed from now on.
+	void Adopt(const T *next)
+	{
+		m_hazard[0].store(next, std::memory_order_seq_cst);
+		m_hazard[1].store(nullptr, std::memory_order_release);
+	};
+
+private:
+	std::atomic<T *> m_latest;
+	std::atomic<const T *> m_hazard[2]; // in use, being switched to
+	std::vector<T *> m_retired;         // writer only
+};
@@ -0,0 +1,139 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "sequence-trie.h"
+
+#include <algorithm>
+#include <atomic>
+
+static uint64_t NextEpoch()
+{
+	static std::atomic<uint64_t> epoch{0};
+	return ++epoch;
+}
+
+bool SequenceTrie::Add(ChordId id, const std::vector<Step> &steps)
+{
+	if (steps.empty() || m_nodes.size() + steps.size() >= (1u << 24) || m_terminals.Find(id))
+		return false;
+
+	// Check for conflicts before touching anything. Any node but the root
+	// either ends a sequence or leads to one.
+	uint32_t node = 0;
+	for (const Step &step : steps) {
+		const uint32_t *child = m_edges.Find(EdgeKey(node, step.chord));
+		if (!child)
+			break;
+		if (m_nodes[*child].terminal != None || &step == &steps.back())
+			return false;
+		node = *child;
+	}
+
+	node = 0;
+	for (const Step &step : steps) {
+		uint32_t &child = m_edges[EdgeKey(node, step.chord)];
+		if (child == 0) {
+			if (!m_freeNodes.empty()) {
+				child = m_freeNodes.back();
+				m_freeNodes.pop_back();
+			} else {
+				child = (uint32_t)m_nodes.size();
+				m_nodes.emplace_back();
+			}
+			m_nodes[child] = Node();
+			m_nodes[child].parent = node;
+			m_nodes[child].via = step.chord;
+		}
+
+		std::vector<uint32_t> &timeouts = m_nodes[child].timeoutsMs;
+		timeouts.insert(std::upper_bound(timeouts.begin(), timeouts.end(), step.timeoutMs), step.timeoutMs);
+		node = child;
+	}
+
+	m_nodes[node].terminal = id;
+	for (const Step &step : steps)
+		m_nodes[node].stepsMs.push_back(step.timeoutMs);
+	m_terminals[id] = node;
+	return true;
+}
+
+bool SequenceTrie::Remove(ChordId id)
+{
+	const uint32_t *last = m_terminals.Find(id);
+	if (!last)
+		return false;
+
+	uint32_t node = *last;
+	std::vector<uint32_t> steps;
+	steps.swap(m_nodes[node].stepsMs);
+	m_nodes[node].terminal = None;
+	m_terminals.Erase(id);
+
+	// Take back the timeouts it gave and free the nodes no other sequence
+	// passes through.
+	for (size_t depth = steps.size(); node != 0; depth--) {
+		Node &n = m_nodes[node];
+		uint32_t parent = n.parent;
+		n.timeoutsMs.erase(std::lower_bound(n.timeoutsMs.begin(), n.timeoutsMs.end(), steps[depth - 1]));
+		if (n.timeoutsMs.empty()) {
+			m_edges.Erase(EdgeKey(parent, n.via));
+			m_freeNodes.push_back(node);
+		}
+		node = parent;
+	}
+	m_epoch = NextEpoch();
+	return true;
+}
+
+void SequenceTrie::Clear()
+{
+	m_nodes.assign(1, Node());
+	m_freeNodes.clear();
+	m_edges.Clear();
+	m_terminals.Clear();
+	m_epoch = NextEpoch();
+}
+
+ChordId SequenceTrie::Advance(Cursor &cursor, ChordId chord, uint32_t nowMs) const
+{
+	if (cursor.node != 0) {
+		const uint32_t *child = m_edges.Find(EdgeKey(cursor.node, chord));
+		if (child && nowMs - cursor.time <= m_nodes[*child].timeoutsMs.back())
+			return Enter(cursor, *child, nowMs);
+	}
+
+	const uint32_t *first = m_edges.Find(EdgeKey(0, chord));
+	if (first)
+		return Enter(cursor, *first, nowMs);
+
+	cursor.node = 0;
+	return None;
+}
+
+ChordId SequenceTrie::Enter(Cursor &cursor, uint32_t node, uint32_t nowMs) const
+{
+	ChordId terminal = m_nodes[node].terminal;
+	if (terminal != None) {
+		cursor.node = 0;
+		return terminal;
+	}
+
+	cursor.node = node;
+	cursor.time = nowMs;
+	return None;
+}
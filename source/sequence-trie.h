@@ -0,0 +1,91 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include "chord-map.h"
+
+#include <stdint.h>
+#include <vector>
+
+// Multi-stroke bindings (Ctrl+K then Ctrl+S) merged into one trie of chord
+// presses. The matcher keeps a single cursor into the trie, so a press costs
+// one hash lookup (two when it has to restart at the root) however many
+// sequences are registered. The cursor lives outside the trie, matching
+// doesn't modify it; a cursor has to be reset when the epoch changes.
+//
+// Every step but the first has to follow the previous one within its timeout.
+// Sequences sharing a prefix share its nodes, and a shared step waits for the
+// longest timeout any of the sequences through it gave it. A press that doesn't continue the
+// current sequence may start a new one. Sequences can't be prefixes of each
+// other, so a completed sequence fires right away without waiting to see if
+// a longer one follows.
+class SequenceTrie {
+public:
+	static constexpr ChordId None = ChordMap<uint32_t>::Empty;
+
+	struct Step {
+		ChordId chord;
+		uint32_t timeoutMs; // since the previous step, unused for the first
+	};
+
+	struct Cursor {
+		uint32_t node = 0; // 0 is the root
+		uint32_t time = 0;
+	};
+
+	SequenceTrie() { Clear(); };
+
+	// False for an empty or too long sequence, an id that is already used, or
+	// steps that are a prefix of another sequence or extend one.
+	bool Add(ChordId id, const std::vector<Step> &steps);
+	bool Remove(ChordId id);
+	void Clear();
+
+	size_t Size() const { return m_terminals.Size(); };
+	bool Contains(ChordId id) const { return m_terminals.Find(id) != nullptr; };
+	// Changes when nodes may have been freed or reused, which invalidates
+	// cursors. Copies keep it, so a copy that was only added to still works
+	// with the original's cursors.
+	uint64_t Epoch() const { return m_epoch; };
+
+	// Feeds one chord press. Returns the id of the sequence it completed, or
+	// None.
+	ChordId Advance(Cursor &cursor, ChordId chord, uint32_t nowMs) const;
+
+private:
+	struct Node {
+		uint32_t parent = 0;
+		ChordId via = None; // chord of the edge from the parent
+		// To get here from the parent, one per sequence passing through,
+		// ascending; the node waits for the last one.
+		std::vector<uint32_t> timeoutsMs;
+		ChordId terminal = None;      // sequence ending here, or None
+		std::vector<uint32_t> stepsMs; // the timeouts it gave, if terminal
+	};
+
+	// Chord ids use the low 24 bits.
+	static ChordId EdgeKey(uint32_t node, ChordId chord) { return (ChordId)node << 24 | chord; };
+
+	ChordId Enter(Cursor &cursor, uint32_t node, uint32_t nowMs) const;
+
+	std::vector<Node> m_nodes; // 0 is the root
+	std::vector<uint32_t> m_freeNodes;
+	ChordMap<uint32_t> m_edges;     // EdgeKey -> child
+	ChordMap<uint32_t> m_terminals; // sequence id -> its last node
+	uint64_t m_epoch;
+};
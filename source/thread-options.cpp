@@ -0,0 +1,161 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "thread-options.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const int DefaultHighPriority = 10;
+static const int DefaultRealtimePriority = 10;
+
+#if defined(_WIN32)
+
+static bool SetPolicy(ThreadPolicy policy, int &priority)
+{
+	static const int levels[] = {THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL};
+	priority = levels[(int)policy];
+	return SetThreadPriority(GetCurrentThread(), priority) != 0;
+}
+
+static bool SetAffinity(uint64_t affinity)
+{
+	// A thread can't be given an empty mask, any CPU is the process's.
+	DWORD_PTR mask = (DWORD_PTR)affinity, system;
+	if (affinity == 0 && !GetProcessAffinityMask(GetCurrentProcess(), &mask, &system))
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+
+#else
+
+static bool SetPolicy(ThreadPolicy policy, int &priority)
+{
+	int sched = SCHED_OTHER;
+	sched_param param = {};
+	if (policy == ThreadPolicy::Realtime) {
+#if defined(__APPLE__)
+		sched = SCHED_RR;
+#else
+		sched = SCHED_FIFO;
+#endif
+		priority = std::min(std::max(priority ? priority : DefaultRealtimePriority, sched_get_priority_min(sched)), sched_get_priority_max(sched));
+		param.sched_priority = priority;
+	} else {
+#if defined(__APPLE__)
+		// SCHED_OTHER priorities do order threads on macOS.
+		priority = policy == ThreadPolicy::High ? sched_get_priority_max(sched) : 0;
+		param.sched_priority = priority ? priority : (sched_get_priority_min(sched) + sched_get_priority_max(sched)) / 2;
+#endif
+	}
+	if (pthread_setschedparam(pthread_self(), sched, &param) != 0)
+		return false;
+
+#if defined(__linux__)
+	// Linux keeps a nice value per thread, taking it back to 0 is always
+	// allowed.
+	int nice = 0;
+	if (policy == ThreadPolicy::High) {
+		priority = std::min(std::max(priority ? priority : DefaultHighPriority, 1), 20);
+		nice = -priority;
+	} else if (policy == ThreadPolicy::Normal) {
+		priority = 0;
+	}
+	if (policy != ThreadPolicy::Realtime && setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) != 0)
+		return false;
+#endif
+	return true;
+}
+
+static bool SetAffinity(uint64_t affinity)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu = 0; cpu < 64; cpu++) {
+		if (affinity == 0 || (affinity >> cpu & 1))
+			CPU_SET(cpu, &set);
+	}
+	if (affinity == 0) {
+		for (int cpu = 64; cpu < CPU_SETSIZE; cpu++)
+			CPU_SET(cpu, &set);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return affinity == 0;
+#endif
+}
+
+#endif
+
+// What this thread was last given, none of the platforms has a plain way to
+// read it back.
+static thread_local uint64_t t_affinity = 0;
+
+ThreadOptions ApplyThreadOptions(const ThreadOptions &options)
+{
+	ThreadOptions applied = options;
+	while (true) {
+		applied.priority = applied.policy == options.policy ? options.priority : 0;
+		if (SetPolicy(applied.policy, applied.priority))
+			break;
+		if (applied.policy == ThreadPolicy::Normal) {
+			applied.priority = 0;
+			break;
+		}
+		applied.policy = (ThreadPolicy)((int)applied.policy - 1);
+	}
+
+	// Only a fallback that took effect is reported.
+	if (SetAffinity(applied.affinity))
+		t_affinity = applied.affinity;
+	else if (applied.affinity != 0 && SetAffinity(0))
+		t_affinity = applied.affinity = 0;
+	else
+		applied.affinity = t_affinity;
+	return applied;
+}
+
+static const char *const PolicyNames[] = {"normal", "high", "realtime"};
+
+bool ParseThreadPolicy(const std::string &name, ThreadPolicy &policy)
+{
+	for (int i = 0; i < 3; i++) {
+		if (name == PolicyNames[i]) {
+			policy = (ThreadPolicy)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *ThreadPolicyName(ThreadPolicy policy)
+{
+	return PolicyNames[(int)policy];
+}
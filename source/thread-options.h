@@ -0,0 +1,52 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+// How the capture thread is scheduled. On a machine with every core busy (an
+// encoder pinned to all of them, say) a thread at normal priority can wait a
+// whole time slice before it sees a key; raising it keeps hotkeys on time.
+//
+//  - Normal is the OS default, and undoes the others.
+//  - High raises it within the time sharing class: a nice value of -priority
+//    on Linux (10 by default), the highest normal thread priority on Windows
+//    and the top of the default policy's range on macOS.
+//  - Realtime uses the real time class: SCHED_FIFO at priority (10 by
+//    default) on Linux, SCHED_RR on macOS, THREAD_PRIORITY_TIME_CRITICAL on
+//    Windows.
+//
+// Affinity is a mask of CPUs (bit n for CPU n) the thread may run on, 0 for
+// any. macOS has no thread affinity and ignores it.
+enum class ThreadPolicy : uint8_t { Normal, High, Realtime };
+
+struct ThreadOptions {
+	ThreadPolicy policy = ThreadPolicy::Normal;
+	int priority = 0; // within the policy, 0 for its default
+	uint64_t affinity = 0;
+};
+
+// Applies options to the calling thread. A policy the OS refuses (real time
+// needs privileges on Linux and macOS) falls back to the next lower one, and
+// an affinity it refuses leaves the thread on any CPU. Returns what took
+// effect, with the priority actually used.
+ThreadOptions ApplyThreadOptions(const ThreadOptions &options);
+
+bool ParseThreadPolicy(const std::string &name, ThreadPolicy &policy);
+const char *ThreadPolicyName(ThreadPolicy policy);
@@ -0,0 +1,186 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+// Hashed timing wheel over wrapping millisecond timestamps. Each slot holds
+// the timers whose deadline falls on it modulo the wheel size, so scheduling
+// and cancelling cost the same however many timers are pending, and advancing
+// visits one slot per elapsed millisecond, at most one full turn. Timers
+// further away than a turn stay in their slot until their turn comes.
+//
+// Timers live in a pool of entries chained per slot by index, freed entries
+// are reused, so nothing is allocated once the pool has grown to the number
+// of timers pending at once. A handle carries the entry's generation, so
+// cancelling one that already fired is harmless.
+//
+// Not thread safe: the owner schedules, cancels and advances it on one thread.
+template<class T, uint32_t Slots = 512> class TimerWheel {
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+public:
+	typedef uint64_t Handle; // 0 is never a valid handle
+
+	explicit TimerWheel(uint32_t now = 0) : m_now(now) { m_slots.fill(Nil); };
+
+	size_t Size() const { return m_size; };
+	uint32_t Now() const { return m_now; };
+
+	// A deadline that already passed fires at the next Advance.
+	Handle Schedule(uint32_t deadline, const T &value)
+	{
+		uint32_t index;
+		if (m_free != Nil) {
+			index = m_free;
+			m_free = m_entries[index].next;
+		} else {
+			index = (uint32_t)m_entries.size();
+			m_entries.emplace_back();
+		}
+
+		Entry &entry = m_entries[index];
+		entry.value = value;
+		entry.deadline = deadline;
+		Link(index, Due(deadline, m_now) ? m_now + 1 : deadline);
+		m_size++;
+		return (Handle)entry.generation << 32 | index;
+	};
+
+	// False if the timer already fired or was cancelled.
+	bool Cancel(Handle handle)
+	{
+		uint32_t index = (uint32_t)handle;
+		if (handle == 0 || index >= m_entries.size() || m_entries[index].generation != (uint32_t)(handle >> 32))
+			return false;
+
+		Unlink(index);
+		Free(index);
+		return true;
+	};
+
+	// Fires every timer due at now, in slot order. fire(value) may schedule
+	// and cancel timers. A clock that went backwards is ignored.
+	template<class F> void Advance(uint32_t now, F fire)
+	{
+		if (m_size == 0) {
+			m_now = now;
+			return;
+		}
+		if (Due(now, m_now))
+			return;
+
+		// After a long gap every slot is visited once.
+		if (now - m_now > Slots)
+			m_now = now - Slots;
+
+		while (m_now != now) {
+			m_now++;
+			m_fired.clear();
+			uint32_t index = m_slots[m_now & Mask];
+			while (index != Nil) {
+				uint32_t next = m_entries[index].next;
+				if (Due(m_entries[index].deadline, now)) {
+					m_fired.push_back(m_entries[index].value);
+					Unlink(index);
+					Free(index);
+				}
+				index = next;
+			}
+			for (const T &value : m_fired)
+				fire(value);
+		}
+	};
+
+	// Milliseconds from Now() to the first slot with a timer, -1 if there is
+	// none. Early, never late, for timers more than a turn away.
+	int32_t NextIn() const
+	{
+		if (m_size == 0)
+			return -1;
+		for (uint32_t i = 1; i <= Slots; i++) {
+			if (m_slots[(m_now + i) & Mask] != Nil)
+				return (int32_t)i;
+		}
+		return -1;
+	};
+
+	void Clear()
+	{
+		m_slots.fill(Nil);
+		m_entries.clear();
+		m_free = Nil;
+		m_size = 0;
+	};
+
+private:
+	static constexpr uint32_t Mask = Slots - 1;
+	static constexpr uint32_t Nil = ~(uint32_t)0;
+
+	struct Entry {
+		T value;
+		uint32_t deadline;
+		uint32_t generation = 1;
+		uint32_t prev, next; // within the slot, next also chains free entries
+		uint32_t slot;
+	};
+
+	static bool Due(uint32_t deadline, uint32_t now) { return (int32_t)(deadline - now) <= 0; };
+
+	void Link(uint32_t index, uint32_t when)
+	{
+		Entry &entry = m_entries[index];
+		entry.slot = when & Mask;
+		entry.prev = Nil;
+		entry.next = m_slots[entry.slot];
+		if (entry.next != Nil)
+			m_entries[entry.next].prev = index;
+		m_slots[entry.slot] = index;
+	};
+
+	void Unlink(uint32_t index)
+	{
+		Entry &entry = m_entries[index];
+		if (entry.prev != Nil)
+			m_entries[entry.prev].next = entry.next;
+		else
+			m_slots[entry.slot] = entry.next;
+		if (entry.next != Nil)
+			m_entries[entry.next].prev = entry.prev;
+	};
+
+	void Free(uint32_t index)
+	{
+		Entry &entry = m_entries[index];
+		if (++entry.generation == 0)
+			entry.generation = 1;
+		entry.value = T();
+		entry.next = m_free;
+		m_free = index;
+		m_size--;
+	};
+
+	uint32_t m_now;
+	std::array<uint32_t, Slots> m_slots;
+	std::vector<Entry> m_entries;
+	uint32_t m_free = Nil;
+	size_t m_size = 0;
+	std::vector<T> m_fired; // scratch for Advance
+};
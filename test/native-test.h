@@ -0,0 +1,70 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+// Minimal harness for the native tests, no external test framework needed.
+
+#pragma once
+#include <iostream>
+#include <functional>
+#include <vector>
+
+struct NativeTest {
+	const char *name;
+	std::function<void()> fn;
+};
+
+inline std::vector<NativeTest> &NativeTests()
+{
+	static std::vector<NativeTest> tests;
+	return tests;
+}
+
+inline int &NativeTestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+struct NativeTestRegistrar {
+	NativeTestRegistrar(const char *name, std::function<void()> fn) { NativeTests().push_back({name, fn}); }
+};
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static NativeTestRegistrar name##_registrar(#name, name); \
+	static void name()
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+			NativeTestFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+inline int RunNativeTests()
+{
+	for (const NativeTest &test : NativeTests()) {
+		int before = NativeTestFailures();
+		test.fn();
+		std::cout << (NativeTestFailures() == before ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+	}
+	return NativeTestFailures() == 0 ? 0 : 1;
+}
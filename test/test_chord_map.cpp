@@ -0,0 +1,95 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "chord-map.h"
+#include "hotkey-engine.h"
+
+#include <map>
+#include <memory>
+#include <random>
+
+TEST_CASE(chord_ids_are_exact)
+{
+	CHECK(MakeChordId(0x41, MOD_CTRL) != MakeChordId(0x41, MOD_SHIFT));
+	CHECK(MakeChordId(0x41, MOD_CTRL) != MakeChordId(0x42, MOD_CTRL));
+	CHECK(MakeChordId(0xFFFF, MOD_ALL) != ChordMap<int>::Empty);
+	CHECK_EQ(MakeChordId({0x41, MOD_CTRL, MOD_ALL}), MakeChordId(0x41, MOD_CTRL));
+}
+
+TEST_CASE(insert_find_erase)
+{
+	ChordMap<int> map;
+	map[1] = 10;
+	map[2] = 20;
+	CHECK_EQ(map.Size(), 2u);
+	CHECK(map.Find(1) && *map.Find(1) == 10);
+	CHECK(!map.Find(3));
+
+	CHECK(map.Erase(1));
+	CHECK(!map.Erase(1));
+	CHECK(!map.Find(1));
+	CHECK_EQ(*map.Find(2), 20);
+	CHECK_EQ(map.Size(), 1u);
+
+	map.Clear();
+	CHECK_EQ(map.Size(), 0u);
+	CHECK(!map.Find(2));
+}
+
+TEST_CASE(move_only_values)
+{
+	ChordMap<std::unique_ptr<int>> map;
+	for (int i = 0; i < 100; i++)
+		map[MakeChordId(i, MOD_SHIFT)].reset(new int(i));
+	CHECK(map.Erase(MakeChordId(50, MOD_SHIFT)));
+	CHECK_EQ(**map.Find(MakeChordId(99, MOD_SHIFT)), 99);
+	CHECK(!map.Find(MakeChordId(50, MOD_SHIFT)));
+}
+
+// Random inserts and erases across growth, checked against std::map. Erasing
+// from the middle of probe runs exercises the backward shift.
+TEST_CASE(matches_reference_map)
+{
+	std::mt19937 rng(1);
+	ChordMap<uint32_t> map;
+	std::map<ChordId, uint32_t> reference;
+
+	for (uint32_t step = 0; step < 200000; step++) {
+		ChordId id = MakeChordId(rng() % 2048, rng() & MOD_ALL);
+		if (rng() % 3) {
+			map[id] = step;
+			reference[id] = step;
+		} else {
+			CHECK_EQ(map.Erase(id), reference.erase(id) == 1);
+		}
+	}
+
+	CHECK_EQ(map.Size(), reference.size());
+	size_t visited = 0;
+	map.ForEach([&](ChordId id, uint32_t value) {
+		CHECK_EQ(reference[id], value);
+		visited++;
+	});
+	CHECK_EQ(visited, reference.size());
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,103 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "dispatch-sequence.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Nothing is dispatching, so there is nothing to wait for.
+TEST_CASE(wait_while_idle_returns)
+{
+	DispatchSequence sequence;
+	sequence.Wait();
+	sequence.Begin();
+	sequence.End();
+	sequence.Wait();
+}
+
+// With separate in flight and done counters, a waiter that read them between
+// the two updates spun until the next dispatch, which may never come.
+TEST_CASE(wait_after_last_dispatch_returns)
+{
+	DispatchSequence sequence;
+	std::atomic<bool> done{false};
+	std::thread dispatcher([&]() {
+		for (int i = 0; i < 100000; i++) {
+			sequence.Begin();
+			sequence.End();
+		}
+		done = true;
+	});
+	while (!done)
+		sequence.Wait();
+	dispatcher.join();
+
+	// Dispatching stopped for good.
+	sequence.Wait();
+}
+
+// A dispatch that began before the swap is waited for, one that begins after
+// it sees the new version.
+TEST_CASE(wait_covers_dispatch_in_flight)
+{
+	DispatchSequence sequence;
+	std::atomic<const int *> published;
+	int versions[2] = {0, 1};
+	published = &versions[0];
+
+	std::atomic<bool> loaded{false}, release{false}, stop{false};
+	std::atomic<int> seen{-1};
+	std::thread dispatcher([&]() {
+		sequence.Begin();
+		const int *version = published.load();
+		loaded = true;
+		while (!release)
+			std::this_thread::yield();
+		seen = *version;
+		sequence.End();
+
+		while (!stop) {
+			sequence.Begin();
+			CHECK(*published.load() == 1);
+			sequence.End();
+		}
+	});
+
+	while (!loaded)
+		std::this_thread::yield();
+	published = &versions[1];
+	std::thread waiter([&]() {
+		sequence.Wait();
+		CHECK(seen == 0);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	CHECK(seen == -1);
+	release = true;
+	waiter.join();
+
+	stop = true;
+	dispatcher.join();
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,398 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "evdev-source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+struct Recorder {
+	std::mutex mtx;
+	std::vector<KeyEvent> events;
+
+	void operator()(const KeyEvent &event)
+	{
+		std::unique_lock<std::mutex> ulock(mtx);
+		events.push_back(event);
+	}
+
+	// Waits until at least count events arrived, or a second passed.
+	std::vector<KeyEvent> Wait(size_t count)
+	{
+		for (int i = 0; i < 1000; i++) {
+			{
+				std::unique_lock<std::mutex> ulock(mtx);
+				if (events.size() >= count)
+					return events;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		std::unique_lock<std::mutex> ulock(mtx);
+		return events;
+	}
+};
+
+static bool WaitFor(const std::function<bool()> &pred)
+{
+	for (int i = 0; i < 1000; i++) {
+		if (pred())
+			return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+static void WriteEvents(int fd, std::initializer_list<std::pair<uint16_t, std::pair<uint16_t, int32_t>>> events)
+{
+	std::vector<struct input_event> ev;
+	for (auto &event : events) {
+		struct input_event e = {};
+		e.type = event.first;
+		e.code = event.second.first;
+		e.value = event.second.second;
+		ev.push_back(e);
+	}
+	CHECK(write(fd, ev.data(), ev.size() * sizeof(ev[0])) == (ssize_t)(ev.size() * sizeof(ev[0])));
+}
+
+static void WriteKey(int fd, uint16_t code, int32_t value)
+{
+	struct input_event ev[2] = {};
+	ev[0].type = EV_KEY;
+	ev[0].code = code;
+	ev[0].value = value;
+	ev[1].type = EV_SYN;
+	ev[1].code = SYN_REPORT;
+	CHECK(write(fd, ev, sizeof(ev)) == sizeof(ev));
+}
+
+TEST_CASE(fifo_device_hotplug)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+
+	Recorder recorder;
+	EvdevSource source(dir);
+	CHECK(source.Start(std::ref(recorder)));
+
+	// Created after Start(), so it has to be discovered through inotify.
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 1; }));
+
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+	WriteKey(fd, KEY_A, 1);
+	WriteKey(fd, KEY_A, 2); // auto-repeat is filtered
+	WriteKey(fd, KEY_A, 0);
+
+	std::vector<KeyEvent> events = recorder.Wait(2);
+	CHECK_EQ(events.size(), 2u);
+	if (events.size() == 2) {
+		CHECK(events[0].key == KEY_A && events[0].down);
+		CHECK(events[1].key == KEY_A && !events[1].down);
+	}
+
+	unlink(path.c_str());
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 0; }));
+
+	source.Stop();
+	close(fd);
+	rmdir(dir);
+}
+
+TEST_CASE(fifo_device_raw_input)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	std::mutex mtx;
+	std::vector<InputEvent> input;
+	Recorder recorder;
+	EvdevSource source(dir);
+	source.SetInputSink([&](const InputEvent &event) {
+		std::unique_lock<std::mutex> ulock(mtx);
+		input.push_back(event);
+	});
+	CHECK(source.Start(std::ref(recorder)));
+
+	// Motion within one report is summed, a held button turns moves into
+	// drags, repeats only reach the raw stream.
+	WriteEvents(fd, {{EV_REL, {REL_X, 3}}, {EV_REL, {REL_Y, -1}}, {EV_REL, {REL_X, 2}}, {EV_SYN, {SYN_REPORT, 0}}});
+	WriteEvents(fd, {{EV_KEY, {BTN_RIGHT, 1}}, {EV_SYN, {SYN_REPORT, 0}}});
+	WriteEvents(fd, {{EV_REL, {REL_Y, 4}}, {EV_REL, {REL_WHEEL, -1}}, {EV_SYN, {SYN_REPORT, 0}}});
+	WriteEvents(fd, {{EV_KEY, {BTN_RIGHT, 0}}, {EV_KEY, {KEY_B, 1}}, {EV_KEY, {KEY_B, 2}}, {EV_SYN, {SYN_REPORT, 0}}});
+
+	CHECK(WaitFor([&] {
+		std::unique_lock<std::mutex> ulock(mtx);
+		return input.size() >= 7;
+	}));
+	source.Stop();
+
+	CHECK_EQ(input.size(), 7u);
+	if (input.size() == 7) {
+		CHECK(input[0].type == InputType::MouseMoved && input[0].x == 5 && input[0].y == -1);
+		CHECK(input[1].type == InputType::MousePressed && input[1].code == 2);
+		CHECK(input[2].type == InputType::MouseDragged && input[2].x == 0 && input[2].y == 4);
+		CHECK(input[3].type == InputType::MouseWheel && input[3].x == 0 && input[3].y == -1);
+		CHECK(input[4].type == InputType::MouseReleased && input[4].code == 2);
+		CHECK(input[5].type == InputType::KeyDown && input[5].code == KEY_B);
+		CHECK(input[6].type == InputType::KeyDown && input[6].code == KEY_B);
+	}
+
+	// The key sink still only sees edges, buttons included.
+	std::vector<KeyEvent> keys = recorder.Wait(3);
+	CHECK_EQ(keys.size(), 3u);
+
+	close(fd);
+	unlink(path.c_str());
+	rmdir(dir);
+}
+
+// After SYN_DROPPED the rest of the report is discarded and the held keys
+// are brought up to date; a FIFO holds none, so A is released.
+TEST_CASE(syn_dropped_resyncs_keys)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	Recorder recorder;
+	EvdevSource source(dir);
+	CHECK(source.Start(std::ref(recorder)));
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 1; }));
+
+	WriteKey(fd, KEY_A, 1);
+	WriteEvents(fd, {{EV_SYN, {SYN_DROPPED, 0}}, {EV_KEY, {KEY_B, 1}}, {EV_SYN, {SYN_REPORT, 0}}});
+	WriteKey(fd, KEY_C, 1);
+
+	std::vector<KeyEvent> events = recorder.Wait(3);
+	CHECK_EQ(events.size(), 3u);
+	if (events.size() == 3) {
+		CHECK(events[0].key == KEY_A && events[0].down);
+		CHECK(events[1].key == KEY_A && !events[1].down);
+		CHECK(events[2].key == KEY_C && events[2].down);
+	}
+
+	source.Stop();
+	close(fd);
+	unlink(path.c_str());
+	rmdir(dir);
+}
+
+// An unplugged keyboard never sends the releases of the keys it held.
+TEST_CASE(unplug_releases_keys)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	Recorder recorder;
+	EvdevSource source(dir);
+	CHECK(source.Start(std::ref(recorder)));
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 1; }));
+
+	WriteKey(fd, KEY_LEFTSHIFT, 1);
+	CHECK_EQ(recorder.Wait(1).size(), 1u);
+	unlink(path.c_str());
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 0; }));
+
+	std::vector<KeyEvent> events = recorder.Wait(2);
+	CHECK_EQ(events.size(), 2u);
+	if (events.size() == 2)
+		CHECK(events[1].key == KEY_LEFTSHIFT && !events[1].down);
+
+	source.Stop();
+	close(fd);
+	rmdir(dir);
+}
+
+// startHookAsync and stopHookAsync wait for this on a worker thread. Stop
+// wakes the reader through its eventfd, it never waits out a timeout.
+TEST_CASE(start_stop_latency)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	typedef std::chrono::steady_clock Clock;
+	const int Cycles = 20;
+	std::vector<double> starts, stops;
+	Recorder recorder;
+	EvdevSource source(dir);
+	for (int i = 0; i < Cycles; i++) {
+		Clock::time_point t0 = Clock::now();
+		CHECK(source.Start(std::ref(recorder)));
+		Clock::time_point t1 = Clock::now();
+		// Let the reader settle in epoll_wait.
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Clock::time_point t2 = Clock::now();
+		source.Stop();
+		Clock::time_point t3 = Clock::now();
+		starts.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+		stops.push_back(std::chrono::duration<double, std::micro>(t3 - t2).count());
+	}
+
+	std::sort(starts.begin(), starts.end());
+	std::sort(stops.begin(), stops.end());
+	std::cout << "  start p50 " << starts[Cycles / 2] << " us, max " << starts.back() << " us; stop p50 " << stops[Cycles / 2]
+		  << " us, max " << stops.back() << " us" << std::endl;
+	// Generous for loaded machines, a poll interval would be far above.
+	CHECK(stops.back() < 50000);
+	CHECK(starts.back() < 50000);
+
+	close(fd);
+	unlink(path.c_str());
+	rmdir(dir);
+}
+
+// A hold confirmed by the timer sink alone, no input after the press.
+TEST_CASE(timer_sink_runs_gesture)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+	std::string path = std::string(dir) + "/event0";
+	CHECK(mkfifo(path.c_str(), 0600) == 0);
+	int fd = open(path.c_str(), O_RDWR);
+	CHECK(fd >= 0);
+
+	typedef std::chrono::steady_clock Clock;
+	std::atomic<int64_t> firedAt{0};
+	HotkeyEngine engine(
+		[&firedAt](ChordId, KeyEdge edge) {
+			if (edge == KeyEdge::Pressed)
+				firedAt = Clock::now().time_since_epoch().count();
+		},
+		EvdevKeyState());
+	CHECK(engine.SetGesture({1, GestureKind::Hold, KEY_SPACE, 0, 50}));
+
+	EvdevSource source(dir);
+	source.SetInputSink([](const InputEvent &) {});
+	source.SetTimerSink([&engine]() { return engine.Tick(); });
+	CHECK(source.Start([&engine](const KeyEvent &event) { engine.OnKeyEvent(event); }));
+	CHECK(WaitFor([&source] { return source.DeviceCount() == 1; }));
+
+	int64_t pressed = Clock::now().time_since_epoch().count();
+	WriteKey(fd, KEY_SPACE, 1);
+	CHECK(WaitFor([&firedAt] { return firedAt != 0; }));
+	double ms = std::chrono::duration<double, std::milli>(Clock::duration(firedAt - pressed)).count();
+	std::cout << "  hold confirmed after " << ms << " ms" << std::endl;
+	CHECK(ms >= 49);
+	CHECK(ms < 500);
+
+	source.Stop();
+	close(fd);
+	unlink(path.c_str());
+	rmdir(dir);
+}
+
+// Wake runs the timer sink again without input, and doesn't stop the reader.
+TEST_CASE(wake_runs_timer_sink)
+{
+	char dir[] = "/tmp/evdev-test-XXXXXX";
+	CHECK(mkdtemp(dir) != nullptr);
+
+	std::atomic<int> calls{0};
+	EvdevSource source(dir);
+	source.SetTimerSink([&calls]() {
+		calls++;
+		return -1;
+	});
+	Recorder recorder;
+	CHECK(source.Start(std::ref(recorder)));
+	CHECK(WaitFor([&calls] { return calls == 1; }));
+
+	source.Wake();
+	CHECK(WaitFor([&calls] { return calls == 2; }));
+	source.Wake();
+	CHECK(WaitFor([&calls] { return calls == 3; }));
+
+	source.Stop();
+	CHECK(calls == 3);
+	rmdir(dir);
+}
+
+TEST_CASE(uinput_keyboard)
+{
+	int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+	if (fd < 0) {
+		std::cout << "  /dev/uinput unavailable, skipped" << std::endl;
+		return;
+	}
+
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(fd, UI_SET_KEYBIT, KEY_F13);
+
+	struct uinput_setup setup = {};
+	setup.id.bustype = BUS_VIRTUAL;
+	strcpy(setup.name, "node-libuiohook test keyboard");
+	CHECK(ioctl(fd, UI_DEV_SETUP, &setup) == 0);
+
+	Recorder recorder;
+	EvdevSource source;
+	CHECK(source.Start(std::ref(recorder)));
+	size_t before = source.DeviceCount();
+
+	CHECK(ioctl(fd, UI_DEV_CREATE) == 0);
+	if (!WaitFor([&source, before] { return source.DeviceCount() > before; })) {
+		std::cout << "  virtual keyboard not readable, skipped" << std::endl;
+		ioctl(fd, UI_DEV_DESTROY);
+		close(fd);
+		return;
+	}
+
+	WriteKey(fd, KEY_F13, 1);
+	WriteKey(fd, KEY_F13, 0);
+
+	std::vector<KeyEvent> events = recorder.Wait(2);
+	CHECK(events.size() >= 2);
+
+	source.Stop();
+	ioctl(fd, UI_DEV_DESTROY);
+	close(fd);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
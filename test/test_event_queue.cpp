@@ -0,0 +1,128 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "event-queue.h"
+
+#include <thread>
+#include <vector>
+
+struct Item {
+	uint64_t seq;
+	uint64_t check;
+};
+
+TEST_CASE(fifo_order_and_wrap)
+{
+	SpscRing<Item> ring(4);
+	CHECK_EQ(ring.Capacity(), 4u);
+
+	Item item;
+	CHECK(!ring.Pop(item));
+	for (uint64_t round = 0; round < 10; round++) {
+		for (uint64_t i = 0; i < 3; i++)
+			CHECK(ring.Push({round * 3 + i, ~(round * 3 + i)}));
+		CHECK_EQ(ring.Size(), 3u);
+		for (uint64_t i = 0; i < 3; i++) {
+			CHECK(ring.Pop(item));
+			CHECK_EQ(item.seq, round * 3 + i);
+			CHECK_EQ(item.check, ~item.seq);
+		}
+		CHECK(!ring.Pop(item));
+	}
+	CHECK_EQ(ring.Dropped(), 0u);
+}
+
+TEST_CASE(drop_newest_keeps_oldest)
+{
+	SpscRing<Item> ring(4, OverflowPolicy::DropNewest);
+	for (uint64_t i = 0; i < 6; i++)
+		CHECK_EQ(ring.Push({i, 0}), i < 4);
+	CHECK_EQ(ring.Dropped(), 2u);
+
+	Item item;
+	for (uint64_t i = 0; i < 4; i++) {
+		CHECK(ring.Pop(item));
+		CHECK_EQ(item.seq, i);
+	}
+	CHECK(!ring.Pop(item));
+}
+
+TEST_CASE(drop_oldest_keeps_newest)
+{
+	SpscRing<Item> ring(4, OverflowPolicy::DropOldest);
+	for (uint64_t i = 0; i < 6; i++)
+		CHECK_EQ(ring.Push({i, 0}), i < 4);
+	CHECK_EQ(ring.Dropped(), 2u);
+
+	Item item;
+	for (uint64_t i = 2; i < 6; i++) {
+		CHECK(ring.Pop(item));
+		CHECK_EQ(item.seq, i);
+	}
+	CHECK(!ring.Pop(item));
+}
+
+// A producer outrunning a slow consumer: whatever survives arrives intact and
+// in order, and every item is either delivered or counted as dropped.
+static void Stress(OverflowPolicy policy)
+{
+	const uint64_t count = 2000000;
+	SpscRing<Item> ring(64, policy);
+
+	std::thread producer([&ring, count]() {
+		for (uint64_t i = 1; i <= count; i++)
+			ring.Push({i, ~i});
+	});
+
+	uint64_t received = 0, last = 0;
+	bool ordered = true, intact = true;
+	Item item;
+	for (;;) {
+		if (ring.Pop(item)) {
+			ordered = ordered && item.seq > last;
+			intact = intact && item.check == ~item.seq;
+			last = item.seq;
+			received++;
+		} else if (last == count || (ring.Size() == 0 && received + ring.Dropped() == count)) {
+			break;
+		}
+	}
+	producer.join();
+	while (ring.Pop(item))
+		received++;
+
+	CHECK(ordered);
+	CHECK(intact);
+	CHECK_EQ(received + ring.Dropped(), count);
+}
+
+TEST_CASE(concurrent_drop_newest)
+{
+	Stress(OverflowPolicy::DropNewest);
+}
+
+TEST_CASE(concurrent_drop_oldest)
+{
+	Stress(OverflowPolicy::DropOldest);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
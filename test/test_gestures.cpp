@@ -0,0 +1,264 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "hotkey-engine.h"
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_A, KEY_B, KEY_SPACE };
+
+struct Fired {
+	ChordId id;
+	KeyEdge edge;
+	uint32_t time;
+};
+
+// An engine on a clock the test moves by hand. Advance ticks the engine the
+// way a source would, at every point Tick asked to be called again.
+struct Harness {
+	uint32_t now = 1000;
+	std::vector<Fired> fired;
+	HotkeyEngine engine;
+
+	Harness()
+		: engine([this](ChordId id, KeyEdge edge) { fired.push_back({id, edge, now}); },
+			 KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}}))
+	{
+		engine.SetClock([this]() { return now; });
+	};
+
+	void Key(keycode_t key, bool down) { engine.OnKeyEvent({key, down}); };
+
+	void Advance(uint32_t ms)
+	{
+		uint32_t end = now + ms;
+		int32_t wait = engine.Tick();
+		while (wait >= 0 && (int32_t)(end - (now + wait)) >= 0) {
+			now += wait;
+			wait = engine.Tick();
+		}
+		now = end;
+	};
+};
+
+TEST_CASE(wheel_fires_in_order_and_cancels)
+{
+	TimerWheel<int, 64> wheel(100);
+	std::vector<int> fired;
+	auto record = [&fired](int value) { fired.push_back(value); };
+
+	TimerWheel<int, 64>::Handle late = wheel.Schedule(130, 3);
+	wheel.Schedule(110, 1);
+	TimerWheel<int, 64>::Handle cancelled = wheel.Schedule(120, 2);
+	wheel.Schedule(50, 0); // already due
+	CHECK_EQ(wheel.Size(), 4u);
+	CHECK_EQ(wheel.NextIn(), 1);
+
+	CHECK(wheel.Cancel(cancelled));
+	CHECK(!wheel.Cancel(cancelled));
+	wheel.Advance(115, record);
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired.size() == 2 && fired[0] == 0 && fired[1] == 1);
+	CHECK_EQ(wheel.NextIn(), 15);
+
+	wheel.Advance(200, record);
+	CHECK_EQ(fired.size(), 3u);
+	CHECK(!wheel.Cancel(late));
+	CHECK_EQ(wheel.Size(), 0u);
+	CHECK_EQ(wheel.NextIn(), -1);
+}
+
+TEST_CASE(wheel_handles_long_timers_and_wrap)
+{
+	TimerWheel<int, 64> wheel(0xFFFFFFC0u);
+	std::vector<int> fired;
+	auto record = [&fired](int value) { fired.push_back(value); };
+
+	// Five turns away, and across the wrap of the clock.
+	wheel.Schedule(0xFFFFFFC0u + 320, 1);
+	wheel.Schedule(0xFFFFFFC0u + 100, 2);
+	for (uint32_t t = 0xFFFFFFC0u + 10; t != 0xFFFFFFC0u + 400; t += 10) {
+		wheel.Advance(t, record);
+		if (t - 0xFFFFFFC0u < 100)
+			CHECK(fired.empty());
+		if (t - 0xFFFFFFC0u == 100)
+			CHECK_EQ(fired.size(), 1u);
+		if (t - 0xFFFFFFC0u == 310)
+			CHECK_EQ(fired.size(), 1u);
+	}
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired.size() == 2 && fired[0] == 2 && fired[1] == 1);
+
+	// A gap of many turns visits each slot once.
+	for (int i = 0; i < 100; i++)
+		wheel.Schedule(wheel.Now() + 1 + i * 7, i);
+	fired.clear();
+	wheel.Advance(wheel.Now() + 100000, record);
+	CHECK_EQ(fired.size(), 100u);
+	CHECK_EQ(wheel.Size(), 0u);
+}
+
+TEST_CASE(wheel_reschedules_from_callback)
+{
+	TimerWheel<int, 64> wheel(0);
+	int runs = 0;
+	std::function<void(int)> again = [&](int value) {
+		runs++;
+		if (value > 0)
+			wheel.Schedule(wheel.Now() + 5, value - 1);
+	};
+	wheel.Schedule(5, 3);
+	wheel.Advance(100, again);
+	CHECK_EQ(runs, 4);
+	CHECK_EQ(wheel.Size(), 0u);
+}
+
+TEST_CASE(hold_fires_after_threshold)
+{
+	Harness h;
+	CHECK(h.engine.SetGesture({1, GestureKind::Hold, KEY_SPACE, 0, 200}));
+
+	// A tap is not a hold.
+	h.Key(KEY_SPACE, true);
+	h.Advance(150);
+	h.Key(KEY_SPACE, false);
+	h.Advance(500);
+	CHECK(h.fired.empty());
+	CHECK_EQ(h.engine.Timers(), 0u);
+
+	// Without any other input, the hold is confirmed exactly on time.
+	uint32_t pressed = h.now;
+	h.Key(KEY_SPACE, true);
+	h.Advance(199);
+	CHECK(h.fired.empty());
+	h.Advance(1);
+	CHECK_EQ(h.fired.size(), 1u);
+	CHECK(h.fired.size() == 1 && h.fired[0].edge == KeyEdge::Pressed && h.fired[0].time == pressed + 200);
+
+	// Auto-repeat changes nothing, release ends it.
+	h.Key(KEY_SPACE, true);
+	h.Advance(1000);
+	h.Key(KEY_SPACE, false);
+	CHECK_EQ(h.fired.size(), 2u);
+	CHECK(h.fired.size() == 2 && h.fired[1].id == 1u && h.fired[1].edge == KeyEdge::Released);
+}
+
+TEST_CASE(long_press_fires_once)
+{
+	Harness h;
+	CHECK(h.engine.SetGesture({2, GestureKind::LongPress, KEY_A, MOD_CTRL, 500}));
+
+	// Wrong modifiers.
+	h.Key(KEY_A, true);
+	h.Advance(600);
+	h.Key(KEY_A, false);
+	CHECK(h.fired.empty());
+
+	h.Key(KEY_CTRL, true);
+	h.Key(KEY_A, true);
+	h.Advance(2000);
+	h.Key(KEY_A, false);
+	h.Key(KEY_CTRL, false);
+	CHECK_EQ(h.fired.size(), 1u);
+	CHECK(h.fired.size() == 1 && h.fired[0].id == 2u && h.fired[0].edge == KeyEdge::Pressed);
+}
+
+TEST_CASE(double_tap_within_window)
+{
+	Harness h;
+	CHECK(h.engine.SetGesture({3, GestureKind::DoubleTap, KEY_B, 0, 300}));
+
+	h.Key(KEY_B, true);
+	h.Advance(50);
+	h.Key(KEY_B, false);
+	h.Advance(200);
+	h.Key(KEY_B, true);
+	h.Key(KEY_B, false);
+	CHECK_EQ(h.fired.size(), 1u);
+	CHECK_EQ(h.engine.Timers(), 0u);
+
+	// The second tap is late; it starts a new first tap instead.
+	h.fired.clear();
+	h.Key(KEY_B, true);
+	h.Key(KEY_B, false);
+	h.Advance(301);
+	CHECK_EQ(h.engine.Timers(), 0u);
+	h.Key(KEY_B, true);
+	h.Key(KEY_B, false);
+	CHECK(h.fired.empty());
+	h.Advance(100);
+	h.Key(KEY_B, true);
+	CHECK_EQ(h.fired.size(), 1u);
+	h.Key(KEY_B, false);
+
+	// A late key event sees the expired window even without a tick.
+	h.fired.clear();
+	h.Key(KEY_B, true);
+	h.Key(KEY_B, false);
+	h.now += 400;
+	h.Key(KEY_B, true);
+	h.Key(KEY_B, false);
+	CHECK(h.fired.empty());
+}
+
+TEST_CASE(gestures_share_a_key)
+{
+	Harness h;
+	CHECK(h.engine.SetGesture({4, GestureKind::Hold, KEY_A, 0, 200}));
+	CHECK(h.engine.SetGesture({5, GestureKind::DoubleTap, KEY_A, 0, 300}));
+	CHECK(!h.engine.SetGesture({5, GestureKind::LongPress, KEY_A, 0, 300}));
+
+	h.Key(KEY_A, true);
+	h.Key(KEY_A, false);
+	h.Advance(100);
+	h.Key(KEY_A, true);
+	h.Advance(300);
+	h.Key(KEY_A, false);
+
+	CHECK_EQ(h.fired.size(), 3u);
+	if (h.fired.size() == 3) {
+		CHECK_EQ(h.fired[0].id, 5u);
+		CHECK_EQ(h.fired[1].id, 4u);
+		CHECK(h.fired[1].edge == KeyEdge::Pressed);
+		CHECK(h.fired[2].edge == KeyEdge::Released);
+	}
+}
+
+TEST_CASE(removed_gesture_stops_silently)
+{
+	Harness h;
+	CHECK(h.engine.SetGesture({6, GestureKind::Hold, KEY_A, 0, 200}));
+	CHECK(h.engine.SetGesture({7, GestureKind::Hold, KEY_B, 0, 200}));
+
+	h.Key(KEY_A, true);
+	h.Key(KEY_B, true);
+	h.Advance(100);
+	h.engine.RemoveGesture(6);
+	h.Advance(200);
+	h.Key(KEY_A, false);
+	h.Key(KEY_B, false);
+
+	// The one that stayed carried on across the switch.
+	CHECK_EQ(h.fired.size(), 2u);
+	CHECK(h.fired.size() == 2 && h.fired[0].id == 7u && h.fired[1].id == 7u);
+	CHECK_EQ(h.engine.Timers(), 0u);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
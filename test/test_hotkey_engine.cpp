@@ -0,0 +1,252 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "hotkey-engine.h"
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_A, KEY_B };
+
+static KeyState TestKeyState()
+{
+	return KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}});
+}
+
+struct Fired {
+	ChordId id;
+	KeyEdge edge;
+};
+
+// Replays a fixed script into whatever sink it is started with.
+class ScriptedSource : public KeyEventSource {
+public:
+	explicit ScriptedSource(std::vector<KeyEvent> script) : m_script(std::move(script)){};
+
+	bool Start(Sink sink) override
+	{
+		for (const KeyEvent &event : m_script)
+			sink(event);
+		return true;
+	};
+	void Stop() override{};
+
+private:
+	std::vector<KeyEvent> m_script;
+};
+
+static std::vector<Fired> Run(Chord chord, std::vector<KeyEvent> script)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(7, chord);
+
+	ScriptedSource source(std::move(script));
+	source.Start([&engine](const KeyEvent &event) { engine.OnKeyEvent(event); });
+	return fired;
+}
+
+TEST_CASE(chord_fires_once_per_edge)
+{
+	// Holding A auto-repeats its key down.
+	std::vector<KeyEvent> script = {{KEY_SHIFT, true}, {KEY_A, true}, {KEY_A, true}, {KEY_A, true}, {KEY_A, false}, {KEY_SHIFT, false}};
+	std::vector<Fired> fired = Run({KEY_A, MOD_SHIFT, MOD_ALL}, script);
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired[0].id == 7 && fired[0].edge == KeyEdge::Pressed);
+	CHECK(fired[1].id == 7 && fired[1].edge == KeyEdge::Released);
+}
+
+TEST_CASE(unbound_modifier_blocks_activation)
+{
+	std::vector<KeyEvent> script = {{KEY_CTRL, true}, {KEY_A, true}, {KEY_A, false}, {KEY_CTRL, false}};
+	std::vector<Fired> fired = Run({KEY_A, 0, MOD_ALL}, script);
+	CHECK(fired.empty());
+}
+
+TEST_CASE(unbound_modifier_does_not_release_held_chord)
+{
+	std::vector<KeyEvent> script = {{KEY_A, true}, {KEY_CTRL, true}, {KEY_CTRL, false}, {KEY_A, false}};
+	std::vector<Fired> fired = Run({KEY_A, 0, MOD_ALL}, script);
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired[1].edge == KeyEdge::Released);
+}
+
+TEST_CASE(modifier_after_trigger_activates)
+{
+	// Only indexed under A, but A is held when Shift arrives.
+	std::vector<KeyEvent> script = {{KEY_A, true}, {KEY_SHIFT, true}, {KEY_SHIFT, false}};
+	std::vector<Fired> fired = Run({KEY_A, MOD_SHIFT, MOD_ALL}, script);
+	CHECK_EQ(fired.size(), 2u);
+}
+
+TEST_CASE(releasing_blocking_modifier_activates)
+{
+	std::vector<KeyEvent> script = {{KEY_CTRL, true}, {KEY_A, true}, {KEY_CTRL, false}};
+	std::vector<Fired> fired = Run({KEY_A, 0, MOD_ALL}, script);
+	CHECK_EQ(fired.size(), 1u);
+}
+
+TEST_CASE(extra_modifiers_accepted_outside_care)
+{
+	std::vector<KeyEvent> script = {{KEY_CTRL, true}, {KEY_SHIFT, true}, {KEY_A, true}};
+	CHECK_EQ(Run({KEY_A, MOD_SHIFT, MOD_SHIFT}, script).size(), 1u);
+	CHECK(Run({KEY_A, MOD_SHIFT, MOD_ALL}, script).empty());
+}
+
+TEST_CASE(modifier_as_key)
+{
+	std::vector<KeyEvent> script = {{KEY_SHIFT, true}, {KEY_SHIFT, false}};
+	CHECK_EQ(Run({KEY_SHIFT, 0, MOD_ALL}, script).size(), 2u);
+}
+
+TEST_CASE(unrelated_keys_do_not_fire)
+{
+	std::vector<Fired> fired = Run({KEY_A, 0, 0}, {{KEY_B, true}, {KEY_B, false}, {KEY_SHIFT, true}});
+	CHECK(fired.empty());
+}
+
+TEST_CASE(removed_hotkey_stops_firing)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(1, {KEY_A, 0, 0});
+	engine.SetHotkey(2, {KEY_B, 0, 0});
+	engine.RemoveHotkey(1);
+
+	engine.OnKeyEvent({KEY_A, true});
+	engine.OnKeyEvent({KEY_B, true});
+	CHECK_EQ(fired.size(), 1u);
+	CHECK_EQ(fired[0].id, 2u);
+	CHECK(engine.State().IsDown(KEY_A));
+}
+
+// A backend that can suppress input, like the Windows hooks: every key event
+// goes through the filter, and only the ones it lets pass reach the
+// "application".
+class SuppressingSource : public KeyEventSource {
+public:
+	explicit SuppressingSource(std::vector<KeyEvent> script) : m_script(std::move(script)){};
+
+	bool Start(Sink) override
+	{
+		for (const KeyEvent &event : m_script) {
+			if (!m_keyFilter(event))
+				passed.push_back(event);
+		}
+		return true;
+	};
+	void Stop() override{};
+
+	std::vector<KeyEvent> passed;
+
+private:
+	std::vector<KeyEvent> m_script;
+};
+
+static std::vector<KeyEvent> Passed(HotkeyEngine &engine, std::vector<KeyEvent> script)
+{
+	SuppressingSource source(std::move(script));
+	source.SetKeyFilter([&engine](const KeyEvent &event) { return engine.OnKeyEvent(event); });
+	source.Start([](const KeyEvent &) {});
+	return source.passed;
+}
+
+static bool Same(const std::vector<KeyEvent> &a, const std::vector<KeyEvent> &b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].key != b[i].key || a[i].down != b[i].down)
+			return false;
+	}
+	return true;
+}
+
+TEST_CASE(consume_swallows_press_repeats_and_release)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(1, {KEY_B, 0, MOD_ALL}, true);
+	CHECK(engine.Consumes(1));
+
+	std::vector<KeyEvent> passed = Passed(engine, {{KEY_B, true}, {KEY_B, true}, {KEY_B, false}, {KEY_A, true}, {KEY_A, false}});
+	CHECK(Same(passed, {{KEY_A, true}, {KEY_A, false}}));
+	CHECK_EQ(fired.size(), 2u);
+}
+
+TEST_CASE(consume_lets_modifiers_and_other_chords_pass)
+{
+	HotkeyEngine engine([](ChordId, KeyEdge) {}, TestKeyState());
+	engine.SetHotkey(1, {KEY_B, MOD_CTRL, MOD_ALL}, true);
+	engine.SetHotkey(2, {KEY_A, MOD_CTRL, MOD_ALL});
+
+	std::vector<KeyEvent> passed = Passed(engine, {{KEY_CTRL, true}, {KEY_B, true}, {KEY_A, true}, {KEY_A, false}, {KEY_B, false}, {KEY_CTRL, false}});
+	CHECK(Same(passed, {{KEY_CTRL, true}, {KEY_A, true}, {KEY_A, false}, {KEY_CTRL, false}}));
+
+	// B alone doesn't activate the chord, so it isn't consumed either.
+	passed = Passed(engine, {{KEY_B, true}, {KEY_B, false}});
+	CHECK_EQ(passed.size(), 2u);
+
+	// Neither is a press that only completes the chord through its modifier.
+	passed = Passed(engine, {{KEY_B, true}, {KEY_CTRL, true}, {KEY_CTRL, false}, {KEY_B, false}});
+	CHECK_EQ(passed.size(), 4u);
+}
+
+TEST_CASE(swallowed_key_stays_swallowed_after_unbinding)
+{
+	HotkeyEngine engine([](ChordId, KeyEdge) {}, TestKeyState());
+	engine.SetHotkey(1, {KEY_B, 0, MOD_ALL}, true);
+
+	CHECK(engine.OnKeyEvent({KEY_B, true}));
+	engine.RemoveHotkey(1);
+	CHECK(engine.OnKeyEvent({KEY_B, true}));
+	CHECK(engine.OnKeyEvent({KEY_B, false}));
+	CHECK(!engine.OnKeyEvent({KEY_B, true}));
+	CHECK(!engine.OnKeyEvent({KEY_B, false}));
+}
+
+TEST_CASE(reset_state_forgets_releases_missed_while_parked)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(1, {KEY_A, MOD_CTRL, MOD_ALL});
+	engine.SetHotkey(2, {KEY_B, 0, MOD_ALL}, true);
+
+	// Parked with the keys held, the releases never arrive.
+	CHECK(engine.OnKeyEvent({KEY_B, true}));
+	engine.OnKeyEvent({KEY_CTRL, true});
+	engine.ResetState();
+	CHECK(!engine.State().IsDown(KEY_CTRL));
+
+	// Re-armed: B is an ordinary press again, not a repeat of a swallowed
+	// one, and Ctrl+A needs a fresh Ctrl.
+	fired.clear();
+	engine.SetHotkey(2, {KEY_B, MOD_SHIFT, MOD_ALL}, true);
+	CHECK(!engine.OnKeyEvent({KEY_B, true}));
+	CHECK(!engine.OnKeyEvent({KEY_B, false}));
+	engine.OnKeyEvent({KEY_A, true});
+	engine.OnKeyEvent({KEY_A, false});
+	CHECK(fired.empty());
+	engine.OnKeyEvent({KEY_CTRL, true});
+	engine.OnKeyEvent({KEY_A, true});
+	CHECK_EQ(fired.size(), 1u);
+	CHECK(!fired.empty() && fired[0].id == 1 && fired[0].edge == KeyEdge::Pressed);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
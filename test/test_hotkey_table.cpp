@@ -0,0 +1,167 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "hotkey-engine.h"
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_A, KEY_B, KEY_K, KEY_FIRST };
+
+struct Fired {
+	ChordId id;
+	KeyEdge edge;
+};
+
+static KeyState TestKeyState()
+{
+	return KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}});
+}
+
+TEST_CASE(table_reuses_slots)
+{
+	HotkeyTable table;
+	uint32_t a = table.SetHotkey(1, {KEY_A, 0, MOD_ALL});
+	uint32_t b = table.SetHotkey(2, {KEY_B, 0, MOD_ALL});
+	CHECK(a != b);
+	CHECK_EQ(table.Candidates(KEY_A).size(), 1u);
+
+	// Same id, other key: moves to the new key.
+	table.SetHotkey(1, {KEY_K, 0, MOD_ALL});
+	CHECK(table.Candidates(KEY_A).empty());
+	CHECK_EQ(table.Candidates(KEY_K).size(), 1u);
+	CHECK_EQ(table.Size(), 2u);
+
+	CHECK(table.RemoveHotkey(2));
+	CHECK(!table.RemoveHotkey(2));
+	CHECK(table.FindSlot(2) == nullptr);
+	CHECK_EQ(table.SetHotkey(3, {KEY_B, 0, MOD_ALL}), b);
+	CHECK_EQ(table.SlotCount(), 2u);
+}
+
+TEST_CASE(copies_are_independent)
+{
+	HotkeyTable table;
+	table.SetHotkey(1, {KEY_A, 0, MOD_ALL});
+	CHECK(table.Sequences().Add(MakeSequenceId(0), {{MakeChordId(KEY_A, 0), 1000}, {MakeChordId(KEY_B, 0), 1000}}));
+
+	HotkeyTable copy(table);
+	copy.SetHotkey(2, {KEY_A, MOD_SHIFT, MOD_ALL});
+	copy.Sequences().Clear();
+	CHECK_EQ(table.Candidates(KEY_A).size(), 1u);
+	CHECK_EQ(copy.Candidates(KEY_A).size(), 2u);
+	CHECK_EQ(table.Sequences().Size(), 1u);
+}
+
+TEST_CASE(publish_swaps_bindings)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(1, {KEY_A, 0, MOD_ALL});
+
+	std::unique_ptr<HotkeyTable> table(new HotkeyTable());
+	engine.SetHotkey(*table, 2, {KEY_B, MOD_CTRL, MOD_ALL});
+	engine.Publish(std::move(table));
+	CHECK_EQ(engine.Table().Size(), 1u);
+	CHECK(engine.Table().FindSlot(1) == nullptr);
+
+	for (KeyEvent event : std::vector<KeyEvent>{{KEY_A, true}, {KEY_A, false}, {KEY_CTRL, true}, {KEY_B, true}, {KEY_B, false}})
+		engine.OnKeyEvent(event);
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired.size() == 2 && fired[0].id == 2 && fired[0].edge == KeyEdge::Pressed);
+	CHECK(fired.size() == 2 && fired[1].id == 2 && fired[1].edge == KeyEdge::Released);
+}
+
+TEST_CASE(publish_keeps_held_chords)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetHotkey(1, {KEY_A, 0, MOD_ALL});
+	engine.OnKeyEvent({KEY_A, true});
+	CHECK_EQ(fired.size(), 1u);
+
+	// A held chord that stays bound neither fires again nor is released by
+	// the swap, and one added while its keys are down waits for the next
+	// press.
+	std::unique_ptr<HotkeyTable> table = engine.CopyTable();
+	engine.SetHotkey(*table, 2, {KEY_A, 0, 0});
+	engine.Publish(std::move(table));
+	engine.OnKeyEvent({KEY_SHIFT, true});
+	engine.OnKeyEvent({KEY_SHIFT, false});
+	CHECK_EQ(fired.size(), 1u);
+
+	engine.OnKeyEvent({KEY_A, false});
+	CHECK_EQ(fired.size(), 2u);
+	CHECK(fired.size() == 2 && fired[1].id == 1 && fired[1].edge == KeyEdge::Released);
+	engine.OnKeyEvent({KEY_A, true});
+	CHECK_EQ(fired.size(), 4u);
+
+	// Dropping a held chord ends it without a release.
+	engine.Publish(std::unique_ptr<HotkeyTable>(new HotkeyTable()));
+	engine.OnKeyEvent({KEY_A, false});
+	CHECK_EQ(fired.size(), 4u);
+}
+
+TEST_CASE(publish_keeps_sequence_progress)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+	engine.SetClock([]() { return 0u; });
+	std::vector<SequenceTrie::Step> steps = {{MakeChordId(KEY_A, 0), 1000}, {MakeChordId(KEY_B, 0), 1000}};
+	CHECK(engine.SetSequence(MakeSequenceId(0), steps));
+
+	// A copy has the same sequences, typing carries on.
+	engine.OnKeyEvent({KEY_A, true});
+	engine.OnKeyEvent({KEY_A, false});
+	engine.Publish(engine.CopyTable());
+	engine.OnKeyEvent({KEY_B, true});
+	engine.OnKeyEvent({KEY_B, false});
+	CHECK_EQ(fired.size(), 1u);
+
+	// A table built from scratch starts over, even with the same sequence.
+	fired.clear();
+	engine.OnKeyEvent({KEY_A, true});
+	engine.OnKeyEvent({KEY_A, false});
+	std::unique_ptr<HotkeyTable> table(new HotkeyTable());
+	CHECK(table->Sequences().Add(MakeSequenceId(0), steps));
+	engine.Publish(std::move(table));
+	engine.OnKeyEvent({KEY_B, true});
+	CHECK(fired.empty());
+}
+
+TEST_CASE(large_batch_built_off_table)
+{
+	std::vector<Fired> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back({id, edge}); }, TestKeyState());
+
+	const uint32_t Count = 10000;
+	std::unique_ptr<HotkeyTable> table(new HotkeyTable());
+	for (uint32_t i = 0; i < Count; i++) {
+		Chord chord = {(keycode_t)(KEY_FIRST + i % 2500), (uint8_t)(i / 2500), MOD_ALL};
+		engine.SetHotkey(*table, MakeChordId(chord), chord);
+	}
+	engine.Publish(std::move(table));
+	CHECK_EQ(engine.Table().Size(), (size_t)Count);
+
+	engine.OnKeyEvent({KEY_FIRST + 42, true});
+	CHECK_EQ(fired.size(), 1u);
+	CHECK(!fired.empty() && fired[0].id == MakeChordId(KEY_FIRST + 42, 0));
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "input-filter.h"
+
+static InputEvent Event(InputType type, uint16_t code = 0)
+{
+	return {type, 0, code, 0, 0, 0};
+}
+
+TEST_CASE(empty_filter_matches_everything)
+{
+	InputFilter filter;
+	for (unsigned type = 0; type < (unsigned)InputType::Count; type++)
+		CHECK(filter.Matches(Event((InputType)type, 42)));
+}
+
+TEST_CASE(types_keys_and_buttons)
+{
+	InputFilter filter;
+	filter.AddType(InputType::KeyDown);
+	filter.AddType(InputType::MousePressed);
+	filter.AddKeyRange(10, 20);
+	filter.AddButton(1);
+
+	CHECK(filter.Matches(Event(InputType::KeyDown, 10)));
+	CHECK(filter.Matches(Event(InputType::KeyDown, 20)));
+	CHECK(!filter.Matches(Event(InputType::KeyDown, 21)));
+	CHECK(!filter.Matches(Event(InputType::KeyUp, 15)));
+	CHECK(filter.Matches(Event(InputType::MousePressed, 1)));
+	CHECK(!filter.Matches(Event(InputType::MousePressed, 2)));
+	CHECK(!filter.Matches(Event(InputType::MouseMoved)));
+
+	// Key ranges don't restrict typed characters, buttons don't restrict
+	// motion.
+	InputFilter typed;
+	typed.AddKeyRange(0, 0);
+	typed.AddButton(3);
+	CHECK(typed.Matches(Event(InputType::KeyTyped, 'a')));
+	CHECK(typed.Matches(Event(InputType::MouseMoved)));
+	CHECK(!typed.Matches(Event(InputType::KeyUp, 1)));
+	CHECK(typed.Matches(Event(InputType::KeyUp, 0)));
+
+	InputFilter top;
+	top.AddKeyRange(0xFFF0, 0xFFFF);
+	CHECK(top.Matches(Event(InputType::KeyDown, 0xFFFF)));
+}
+
+TEST_CASE(merge_is_a_union)
+{
+	InputFilter keys;
+	keys.AddType(InputType::KeyDown);
+	keys.AddKeyRange(1, 2);
+
+	InputFilter clicks;
+	clicks.AddType(InputType::MousePressed);
+	clicks.AddButton(2);
+
+	InputFilter all = keys;
+	all.Merge(clicks);
+	CHECK(all.Matches(Event(InputType::KeyDown, 2)));
+	CHECK(!all.Matches(Event(InputType::KeyDown, 3)));
+	CHECK(all.Matches(Event(InputType::MousePressed, 2)));
+	CHECK(!all.Matches(Event(InputType::MousePressed, 1)));
+	CHECK(!all.Matches(Event(InputType::MouseMoved)));
+
+	// Merging an unrestricted filter lifts the restriction.
+	all.Merge(InputFilter());
+	CHECK(all.Matches(Event(InputType::KeyDown, 3)));
+	CHECK(all.Matches(Event(InputType::MouseMoved)));
+}
+
+TEST_CASE(shared_filter_publish)
+{
+	SharedInputFilter shared;
+	CHECK(!shared.Enabled());
+	CHECK(!shared.Matches(Event(InputType::KeyDown, 1)));
+
+	InputFilter filter;
+	filter.AddType(InputType::MouseWheel);
+	shared.Publish(filter);
+	CHECK(shared.Enabled());
+	CHECK(shared.Matches(Event(InputType::MouseWheel)));
+	CHECK(!shared.Matches(Event(InputType::KeyDown, 1)));
+
+	shared.Publish(InputFilter());
+	CHECK(shared.Matches(Event(InputType::KeyDown, 1)));
+	CHECK(shared.Matches(Event(InputType::MouseDragged)));
+
+	shared.Disable();
+	CHECK(!shared.Matches(Event(InputType::MouseWheel)));
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,147 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "input-recorder.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+// ctest runs tests in the build directory.
+static const char *RecordingPath = "test_input_recorder.trace";
+
+static InputEvent Event(uint16_t code)
+{
+	return {InputType::KeyDown, 0, code, 0, 0, 0};
+}
+
+// Waits for the helper thread to make room, as a real recording would by
+// being slower than it.
+static bool WaitForRoom(const InputRecorder &recorder)
+{
+	for (int i = 0; i < 2000 && recorder.Count() >= recorder.Capacity(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	return recorder.Count() < recorder.Capacity();
+}
+
+TEST_CASE(grows_and_reads_back)
+{
+	InputRecorder::Options options;
+	options.initialRecords = 16;
+	options.growIntervalMs = 1;
+
+	InputRecorder recorder;
+	CHECK(recorder.Start(RecordingPath, options));
+	CHECK(recorder.Recording());
+	CHECK(!recorder.Start(RecordingPath, options));
+
+	const uint16_t Count = 5000;
+	std::thread hook([&recorder]() {
+		for (uint16_t i = 0; i < Count; i++) {
+			if (!WaitForRoom(recorder))
+				break;
+			recorder.Append(Event(i), 1000 + i * 10);
+		}
+	});
+	hook.join();
+
+	CHECK(recorder.Capacity() >= Count);
+	CHECK_EQ(recorder.Dropped(), 0u);
+	CHECK_EQ(recorder.Stop(), (uint64_t)Count);
+	CHECK(!recorder.Recording());
+
+	TraceReader reader;
+	CHECK(reader.Open(RecordingPath));
+	CHECK(reader.Platform() == CurrentTracePlatform);
+	const std::vector<TraceRecord> &records = reader.Records();
+	CHECK_EQ(records.size(), (size_t)Count);
+	bool ordered = true;
+	for (size_t i = 0; i < records.size(); i++)
+		ordered &= records[i].event.code == i && records[i].timeNs == i * 10;
+	CHECK(ordered);
+	remove(RecordingPath);
+}
+
+TEST_CASE(readable_while_recording)
+{
+	InputRecorder recorder;
+	CHECK(recorder.Start(RecordingPath));
+	for (uint16_t i = 0; i < 3; i++)
+		recorder.Append(Event(i), i);
+
+	// The file is preallocated well past the records, the header says where
+	// they end.
+	TraceReader reader;
+	CHECK(reader.Open(RecordingPath));
+	CHECK_EQ(reader.Records().size(), 3u);
+
+	CHECK_EQ(recorder.Stop(), 3u);
+	CHECK_EQ(recorder.Stop(), 0u);
+	remove(RecordingPath);
+}
+
+TEST_CASE(readable_before_the_first_event)
+{
+	InputRecorder recorder;
+	CHECK(recorder.Start(RecordingPath));
+
+	TraceReader reader;
+	CHECK(reader.Open(RecordingPath));
+	CHECK_EQ(reader.Records().size(), 0u);
+
+	CHECK_EQ(recorder.Stop(), 0u);
+	CHECK(reader.Open(RecordingPath));
+	CHECK_EQ(reader.Records().size(), 0u);
+	remove(RecordingPath);
+}
+
+TEST_CASE(full_recording_drops)
+{
+	InputRecorder::Options options;
+	options.initialRecords = 4;
+	options.maxBytes = sizeof(TraceHeader) + 8 * sizeof(TraceRecord);
+
+	InputRecorder recorder;
+	CHECK(recorder.Start(RecordingPath, options));
+	for (uint16_t i = 0; i < 20; i++) {
+		if (i < 8)
+			CHECK(WaitForRoom(recorder));
+		recorder.Append(Event(i), i);
+	}
+	CHECK_EQ(recorder.Capacity(), 8u);
+	CHECK_EQ(recorder.Dropped(), 12u);
+	CHECK_EQ(recorder.Stop(), 8u);
+
+	// Appending while stopped does nothing.
+	recorder.Append(Event(0), 0);
+	CHECK_EQ(recorder.Count(), 0u);
+	remove(RecordingPath);
+}
+
+TEST_CASE(bad_path_fails)
+{
+	InputRecorder recorder;
+	CHECK(!recorder.Start("no-such-directory/recording.trace"));
+	CHECK(!recorder.Recording());
+}
+
+int main()
+{
+	return RunNativeTests();
+}
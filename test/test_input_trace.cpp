@@ -0,0 +1,133 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "input-trace.h"
+
+#include <stdio.h>
+
+// ctest runs tests in the build directory.
+static const char *TracePath = "test_input_trace.trace";
+
+static InputEvent Event(InputType type, uint16_t code, int32_t x = 0, int32_t y = 0)
+{
+	return {type, 0, code, x, y, 0};
+}
+
+TEST_CASE(round_trip)
+{
+	TraceWriter writer;
+	CHECK(writer.Open(TracePath));
+	CHECK(writer.Append(5000, Event(InputType::KeyDown, 30)));
+	CHECK(writer.Append(5100, Event(InputType::KeyDown, 30))); // repeat
+	CHECK(writer.Append(9000, Event(InputType::MouseMoved, 0, -3, 7)));
+	CHECK(writer.Append(12000, Event(InputType::KeyUp, 30)));
+	CHECK_EQ(writer.Count(), 4u);
+	CHECK(writer.Close());
+
+	TraceReader reader;
+	CHECK(reader.Open(TracePath));
+	CHECK(reader.Platform() == CurrentTracePlatform);
+	const std::vector<TraceRecord> &records = reader.Records();
+	CHECK_EQ(records.size(), 4u);
+	if (records.size() == 4) {
+		CHECK_EQ(records[0].timeNs, 0u);
+		CHECK_EQ(records[1].timeNs, 100u);
+		CHECK(records[2].event.type == InputType::MouseMoved && records[2].event.x == -3 && records[2].event.y == 7);
+		CHECK(records[3].event.type == InputType::KeyUp && records[3].event.code == 30);
+		CHECK_EQ(records[3].timeNs, 7000u);
+	}
+	remove(TracePath);
+}
+
+TEST_CASE(unfinished_trace_reads_whole_records)
+{
+	// A writer that never closed leaves the count unknown and maybe half a
+	// record behind.
+	TraceHeader header = {};
+	memcpy(header.magic, TraceMagic, sizeof(header.magic));
+	header.version = TraceVersion;
+	header.recordSize = sizeof(TraceRecord);
+	header.platform = (uint32_t)TracePlatform::Linux;
+	header.count = TraceCountUnknown;
+	TraceRecord record = {42, Event(InputType::KeyDown, 1)};
+
+	FILE *file = fopen(TracePath, "wb");
+	CHECK(file != nullptr);
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&record, sizeof(record), 1, file);
+	fwrite(&record, sizeof(record) / 2, 1, file);
+	fclose(file);
+
+	TraceReader reader;
+	CHECK(reader.Open(TracePath));
+	CHECK(reader.Platform() == TracePlatform::Linux);
+	CHECK_EQ(reader.Records().size(), 1u);
+	remove(TracePath);
+}
+
+TEST_CASE(header_count_is_authoritative)
+{
+	// Zero-filled records past the count, as an InputRecorder preallocates.
+	TraceHeader header = {};
+	memcpy(header.magic, TraceMagic, sizeof(header.magic));
+	header.version = TraceVersion;
+	header.recordSize = sizeof(TraceRecord);
+	header.count = 0;
+	TraceRecord empty = {};
+
+	FILE *file = fopen(TracePath, "wb");
+	CHECK(file != nullptr);
+	fwrite(&header, sizeof(header), 1, file);
+	for (int i = 0; i < 16; i++)
+		fwrite(&empty, sizeof(empty), 1, file);
+	fclose(file);
+
+	TraceReader reader;
+	CHECK(reader.Open(TracePath));
+	CHECK_EQ(reader.Records().size(), 0u);
+
+	// Version 1 writers left 0 for unknown.
+	header.version = 1;
+	file = fopen(TracePath, "r+b");
+	CHECK(file != nullptr);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	CHECK(reader.Open(TracePath));
+	CHECK_EQ(reader.Records().size(), 16u);
+	remove(TracePath);
+}
+
+TEST_CASE(rejects_other_files)
+{
+	FILE *file = fopen(TracePath, "wb");
+	CHECK(file != nullptr);
+	fputs("certainly not a trace, but long enough for a header", file);
+	fclose(file);
+
+	TraceReader reader;
+	CHECK(!reader.Open(TracePath));
+	CHECK(!reader.Error().empty());
+	CHECK(!reader.Open("does-not-exist.trace"));
+	remove(TracePath);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "key-names.h"
+
+#include <string>
+
+static constexpr KeyName kSpec[] = {{"Alpha", 1}, {"Beta", 2}, {"Gamma", NO_KEY}};
+static constexpr KeyNameTable<3> kTable(kSpec);
+
+static constexpr keycode_t Lookup(const KeyNameTable<3> &table, const char *name)
+{
+	keycode_t code = 0;
+	return table.Find(name, code) ? code : 0xFFFF;
+}
+
+// Lookups are usable in constant expressions.
+static_assert(Lookup(kTable, "Beta") == 2, "constexpr lookup");
+static_assert(Lookup(kTable, "Delta") == 0xFFFF, "constexpr miss");
+
+TEST_CASE(every_spec_name_resolves)
+{
+	for (const KeyName &entry : g_KeyNameSpec) {
+		keycode_t code = 0;
+		CHECK_EQ(g_KeyNames.Find(entry.name, code), entry.code != NO_KEY);
+		if (entry.code != NO_KEY)
+			CHECK_EQ(code, entry.code);
+	}
+}
+
+TEST_CASE(unknown_and_unbindable_names_miss)
+{
+	keycode_t code = 0;
+	CHECK(!g_KeyNames.Find("", code));
+	CHECK(!g_KeyNames.Find("keya", code));
+	CHECK(!g_KeyNames.Find("KeyA ", code));
+	CHECK(!g_KeyNames.Find(std::string("KeyAB"), code));
+	CHECK(!kTable.Find("Gamma", code));
+}
+
+TEST_CASE(modifier_aliases_share_codes)
+{
+	keycode_t menu = 0, alt = 0, osLeft = 0, shiftLeft = 0;
+	CHECK(g_KeyNames.Find("Menu", menu));
+	CHECK(g_KeyNames.Find("Alt", alt));
+	CHECK_EQ(menu, alt);
+	CHECK(g_KeyNames.Find("OSLeft", osLeft));
+	CHECK(g_KeyNames.Find("ShiftLeft", shiftLeft));
+	CHECK(osLeft != shiftLeft);
+}
+
+TEST_CASE(duplicate_names_are_rejected)
+{
+	static constexpr KeyName duplicated[] = {{"Alpha", 1}, {"Beta", 2}, {"Alpha", 3}};
+	constexpr KeyNameTable<3> table(duplicated);
+	CHECK(!table.Valid());
+	CHECK(kTable.Valid());
+}
+
+int main()
+{
+	return RunNativeTests();
+}
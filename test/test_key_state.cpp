@@ -0,0 +1,78 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "key-state.h"
+
+enum : keycode_t { SHIFT = 0x10, SHIFT_L = 0xA0, SHIFT_R = 0xA1, CTRL_L = 0xA2, KEY_A = 0x41, HIGH_KEY = 0xFF7E };
+
+static KeyState TestKeyState()
+{
+	return KeyState({{SHIFT, MOD_SHIFT, true}, {SHIFT_L, MOD_SHIFT, false}, {SHIFT_R, MOD_SHIFT, false}, {CTRL_L, MOD_CTRL, false}});
+}
+
+TEST_CASE(bitmap_tracks_any_code)
+{
+	KeyState state;
+	KeyEvent edges[2];
+	CHECK_EQ(state.Update({HIGH_KEY, true}, edges), 1u);
+	CHECK(state.IsDown(HIGH_KEY));
+	CHECK(!state.IsDown(HIGH_KEY - 1));
+	CHECK_EQ(state.Update({HIGH_KEY, true}, edges), 0u);
+	CHECK_EQ(state.Update({HIGH_KEY, false}, edges), 1u);
+	CHECK(!state.IsDown(HIGH_KEY));
+}
+
+TEST_CASE(sided_modifiers_drive_mask_and_generic)
+{
+	KeyState state = TestKeyState();
+	KeyEvent edges[2];
+
+	CHECK_EQ(state.Update({SHIFT_L, true}, edges), 2u);
+	CHECK(edges[1].key == SHIFT && edges[1].down);
+	CHECK_EQ(state.Modifiers(), MOD_SHIFT);
+
+	// The other side doesn't change the generic key.
+	CHECK_EQ(state.Update({SHIFT_R, true}, edges), 1u);
+	CHECK_EQ(state.Update({SHIFT_L, false}, edges), 1u);
+	CHECK(state.IsDown(SHIFT));
+	CHECK_EQ(state.Modifiers(), MOD_SHIFT);
+
+	CHECK_EQ(state.Update({CTRL_L, true}, edges), 1u);
+	CHECK_EQ(state.Modifiers(), MOD_SHIFT | MOD_CTRL);
+
+	CHECK_EQ(state.Update({SHIFT_R, false}, edges), 2u);
+	CHECK(edges[1].key == SHIFT && !edges[1].down);
+	CHECK(!state.IsDown(SHIFT));
+	CHECK_EQ(state.Modifiers(), MOD_CTRL);
+}
+
+TEST_CASE(ordinary_keys_leave_mask_alone)
+{
+	KeyState state = TestKeyState();
+	KeyEvent edges[2];
+	state.Update({KEY_A, true}, edges);
+	CHECK_EQ(state.Modifiers(), 0);
+	CHECK_EQ(state.ModifierOf(KEY_A), 0);
+	CHECK_EQ(state.ModifierOf(SHIFT_R), MOD_SHIFT);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
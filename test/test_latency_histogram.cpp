@@ -0,0 +1,91 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "latency-histogram.h"
+
+#include <thread>
+
+TEST_CASE(buckets_cover_every_value)
+{
+	// Small values are exact, the rest land in a bucket whose top is within
+	// 1/16 above them.
+	for (uint64_t ns = 0; ns < 16; ns++)
+		CHECK_EQ(LatencyHistogram::Highest(LatencyHistogram::Index(ns)), ns);
+
+	for (uint64_t ns = 16; ns < ((uint64_t)1 << 62); ns = ns * 3 + 7) {
+		uint32_t index = LatencyHistogram::Index(ns);
+		uint64_t top = LatencyHistogram::Highest(index);
+		CHECK(index < LatencyHistogram::Buckets);
+		CHECK(top >= ns && top - ns <= ns / 16);
+		CHECK_EQ(LatencyHistogram::Index(top), index);
+		CHECK_EQ(LatencyHistogram::Index(top + 1), index + 1);
+	}
+	CHECK(LatencyHistogram::Index(UINT64_MAX) == LatencyHistogram::Buckets - 1);
+}
+
+TEST_CASE(percentiles)
+{
+	LatencyHistogram histogram;
+	CHECK_EQ(histogram.Percentile(0.5), 0u);
+
+	// 1..1000 us.
+	for (uint64_t us = 1; us <= 1000; us++)
+		histogram.Record(us * 1000);
+	CHECK_EQ(histogram.Count(), 1000u);
+	CHECK_EQ(histogram.Max(), 1000000u);
+
+	uint64_t p50 = histogram.Percentile(0.5);
+	uint64_t p99 = histogram.Percentile(0.99);
+	CHECK(p50 >= 500000 && p50 <= 500000 + 500000 / 16);
+	CHECK(p99 >= 990000 && p99 <= 1000000);
+	CHECK_EQ(histogram.Percentile(1.0), 1000000u);
+
+	histogram.Reset();
+	CHECK_EQ(histogram.Count(), 0u);
+	CHECK_EQ(histogram.Max(), 0u);
+}
+
+TEST_CASE(concurrent_record_and_read)
+{
+	LatencyHistogram histogram;
+	const uint64_t Count = 200000;
+	std::thread writer([&histogram]() {
+		for (uint64_t i = 0; i < Count; i++)
+			histogram.Record(i % 5000);
+	});
+
+	uint64_t last = 0;
+	bool monotonic = true;
+	while (last < Count) {
+		uint64_t count = histogram.Count();
+		monotonic &= count >= last;
+		last = count;
+		histogram.Percentile(0.99);
+	}
+	writer.join();
+
+	CHECK(monotonic);
+	CHECK_EQ(histogram.Count(), Count);
+	CHECK_EQ(histogram.Max(), 4999u);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
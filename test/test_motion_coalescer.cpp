@@ -0,0 +1,150 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "motion-coalescer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static InputEvent Move(int32_t x, int32_t y, uint32_t time = 0, InputType type = InputType::MouseMoved)
+{
+	return {type, 0, 0, x, y, time};
+}
+
+static uint32_t NowMs()
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST_CASE(latest_position_wins)
+{
+	MotionCoalescer motion;
+	InputEvent event;
+	CHECK(!motion.Take(0, event));
+
+	motion.Offer(Move(10, 10, 1));
+	motion.Offer(Move(12, 15, 2));
+	motion.Offer(Move(20, 11, 3, InputType::MouseDragged));
+	CHECK(motion.Take(0, event));
+	CHECK(event.type == InputType::MouseDragged);
+	CHECK(event.x == 20 && event.y == 11 && event.time == 3);
+	CHECK(!motion.Take(0, event));
+}
+
+TEST_CASE(deltas_are_summed)
+{
+	MotionCoalescer motion;
+	motion.SetOptions({0, true});
+	InputEvent event;
+
+	motion.Offer(Move(100, 100));
+	motion.Offer(Move(103, 98));
+	motion.Offer(Move(110, 90));
+	CHECK(motion.Take(0, event));
+	CHECK(event.x == 10 && event.y == -10);
+
+	motion.Offer(Move(111, 90));
+	CHECK(motion.Take(0, event));
+	CHECK(event.x == 1 && event.y == 0);
+
+	// Relative sources already report motion.
+	MotionCoalescer relative(true);
+	relative.Offer(Move(3, 1));
+	relative.Offer(Move(-1, 2));
+	CHECK(relative.Take(0, event));
+	CHECK(event.x == 2 && event.y == 3);
+}
+
+TEST_CASE(rate_limit)
+{
+	MotionCoalescer motion;
+	motion.SetOptions({50, false}); // one update per 20 ms
+	InputEvent event;
+
+	motion.Offer(Move(1, 1));
+	CHECK(motion.Take(1000, event));
+
+	motion.Offer(Move(2, 2));
+	CHECK_EQ(motion.Due(1005), 15u);
+	CHECK(!motion.Take(1005, event));
+	motion.Offer(Move(3, 3));
+	CHECK(!motion.Take(1019, event));
+	CHECK(motion.Take(1020, event));
+	CHECK(event.x == 3);
+
+	// Idle longer than the interval, the next move goes out right away.
+	motion.Offer(Move(4, 4));
+	CHECK_EQ(motion.Due(2000), 0u);
+	CHECK(motion.Take(2000, event));
+}
+
+// A synthetic 10 kHz mouse against a consumer limited to 100 updates per
+// second: the consumer sees a bounded number of updates, the last one is the
+// final position and the deltas add up to the whole path.
+TEST_CASE(high_rate_generator)
+{
+	const int Moves = 3000;
+	MotionCoalescer positions;
+	MotionCoalescer deltas;
+	positions.SetOptions({100, false});
+	deltas.SetOptions({100, true});
+
+	std::atomic<bool> done{false};
+	std::thread generator([&]() {
+		for (int i = 1; i <= Moves; i++) {
+			positions.Offer(Move(i, -i));
+			deltas.Offer(Move(i, -i));
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		done = true;
+	});
+
+	uint32_t start = NowMs();
+	size_t updates = 0;
+	int64_t sumX = 0, sumY = 0;
+	InputEvent last = {}, event;
+	while (!done || positions.Pending() || deltas.Pending()) {
+		uint32_t now = NowMs();
+		if (positions.Take(now, event)) {
+			last = event;
+			updates++;
+		}
+		if (deltas.Take(now, event)) {
+			sumX += event.x;
+			sumY += event.y;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+	generator.join();
+	uint32_t elapsed = NowMs() - start;
+
+	CHECK(updates >= 2);
+	CHECK(updates <= elapsed / 10 + 2);
+	CHECK(updates < (size_t)Moves / 4);
+	CHECK(last.x == Moves && last.y == -Moves);
+	// The first absolute move has no predecessor to measure from.
+	CHECK_EQ(sumX, Moves - 1);
+	CHECK_EQ(sumY, -(Moves - 1));
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "pressed-keys.h"
+
+#include <algorithm>
+#include <thread>
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_LSHIFT, KEY_RSHIFT, KEY_A, KEY_HIGH = 0xFF00 };
+
+static KeyState TestKeyState()
+{
+	return KeyState({{KEY_SHIFT, MOD_SHIFT, true}, {KEY_LSHIFT, MOD_SHIFT, false}, {KEY_RSHIFT, MOD_SHIFT, false}});
+}
+
+TEST_CASE(tracks_keys_and_generic_modifiers)
+{
+	PressedKeys pressed(TestKeyState());
+	std::vector<keycode_t> keys;
+
+	pressed.Update({KEY_A, true});
+	pressed.Update({KEY_A, true}); // repeat
+	pressed.Update({KEY_HIGH, true});
+	pressed.Update({KEY_LSHIFT, true});
+	CHECK(pressed.IsDown(KEY_A));
+	CHECK(pressed.IsDown(KEY_SHIFT));
+	CHECK(!pressed.IsDown(KEY_RSHIFT));
+	CHECK_EQ(pressed.Modifiers(), MOD_SHIFT);
+
+	pressed.Snapshot(keys);
+	CHECK(keys == std::vector<keycode_t>({KEY_SHIFT, KEY_LSHIFT, KEY_A, KEY_HIGH}));
+
+	// The generic key stays down while either side is.
+	pressed.Update({KEY_RSHIFT, true});
+	pressed.Update({KEY_LSHIFT, false});
+	CHECK(pressed.IsDown(KEY_SHIFT));
+	pressed.Update({KEY_RSHIFT, false});
+	pressed.Update({KEY_A, false});
+	CHECK(!pressed.IsDown(KEY_SHIFT));
+	CHECK_EQ(pressed.Modifiers(), 0);
+
+	pressed.Snapshot(keys);
+	CHECK(keys == std::vector<keycode_t>({KEY_HIGH}));
+
+	pressed.Reset();
+	pressed.Snapshot(keys);
+	CHECK(keys.empty());
+	CHECK(!pressed.IsDown(KEY_HIGH));
+}
+
+// A side and its generic key change in one update, so no snapshot may show
+// one without the other.
+TEST_CASE(snapshots_are_consistent)
+{
+	PressedKeys pressed(TestKeyState());
+	std::atomic<bool> done{false};
+
+	std::thread writer([&pressed, &done]() {
+		for (int i = 0; i < 200000; i++) {
+			pressed.Update({KEY_LSHIFT, true});
+			pressed.Update({(keycode_t)(KEY_HIGH + (i & 7)), true});
+			pressed.Update({KEY_LSHIFT, false});
+			pressed.Update({(keycode_t)(KEY_HIGH + (i & 7)), false});
+		}
+		done = true;
+	});
+
+	size_t snapshots = 0, torn = 0, held = 0;
+	std::vector<keycode_t> keys;
+	while (!done) {
+		pressed.Snapshot(keys);
+		bool side = std::find(keys.begin(), keys.end(), KEY_LSHIFT) != keys.end();
+		bool generic = std::find(keys.begin(), keys.end(), KEY_SHIFT) != keys.end();
+		torn += side != generic;
+		held += side;
+		snapshots++;
+	}
+	writer.join();
+
+	std::cout << "  " << snapshots << " snapshots, " << held << " with shift held" << std::endl;
+	CHECK(snapshots > 0);
+	CHECK_EQ(torn, 0u);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
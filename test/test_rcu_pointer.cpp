@@ -0,0 +1,151 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "hotkey-engine.h"
+#include "rcu-pointer.h"
+
+#include <atomic>
+#include <thread>
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_A, KEY_FIRST };
+
+// Counts live instances, and fills itself with a pattern that a use after
+// free or a torn publish would break.
+struct Version {
+	static std::atomic<int> live;
+
+	explicit Version(uint32_t serial) : serial(serial), words(64, serial) { live++; };
+	~Version()
+	{
+		words.assign(words.size(), 0xDEADBEEF);
+		live--;
+	};
+
+	bool Intact() const
+	{
+		for (uint32_t word : words) {
+			if (word != serial)
+				return false;
+		}
+		return true;
+	};
+
+	uint32_t serial;
+	std::vector<uint32_t> words;
+};
+std::atomic<int> Version::live{0};
+
+TEST_CASE(reader_switches_on_peek)
+{
+	{
+		RcuPointer<Version> cell(std::unique_ptr<Version>(new Version(0)));
+		CHECK(cell.Peek() == nullptr);
+
+		cell.Publish(std::unique_ptr<Version>(new Version(1)));
+		cell.Publish(std::unique_ptr<Version>(new Version(2)));
+		// Version 1 was never seen by the reader, only 0 is held back.
+		CHECK_EQ(cell.Reclaim(), 1u);
+		CHECK_EQ(cell.Current().serial, 0u);
+
+		const Version *next = cell.Peek();
+		CHECK(next && next->serial == 2);
+		CHECK_EQ(cell.Reclaim(), 1u);
+		cell.Adopt(next);
+		CHECK_EQ(cell.Reclaim(), 0u);
+		CHECK(cell.Peek() == nullptr);
+		CHECK_EQ(Version::live.load(), 1);
+	}
+	CHECK_EQ(Version::live.load(), 0);
+}
+
+TEST_CASE(concurrent_publish_and_read)
+{
+	{
+		RcuPointer<Version> cell(std::unique_ptr<Version>(new Version(0)));
+		std::atomic<bool> done{false};
+		std::atomic<uint32_t> broken{0};
+
+		std::thread reader([&]() {
+			uint32_t last = 0;
+			while (!done.load()) {
+				if (const Version *next = cell.Peek()) {
+					if (!next->Intact() || next->serial < last)
+						broken++;
+					last = next->serial;
+					cell.Adopt(next);
+				}
+				if (!cell.Current().Intact())
+					broken++;
+			}
+		});
+
+		for (uint32_t i = 1; i <= 20000; i++)
+			cell.Publish(std::unique_ptr<Version>(new Version(i)));
+		done = true;
+		reader.join();
+
+		CHECK_EQ(broken.load(), 0u);
+		CHECK(cell.Reclaim() <= 2u);
+		CHECK(Version::live.load() <= 3);
+	}
+	CHECK_EQ(Version::live.load(), 0);
+}
+
+TEST_CASE(engine_edits_while_matching)
+{
+	// The hook thread keeps tapping Ctrl+A while the other thread rebinds it
+	// over and over. Every release must follow a press, whatever table the
+	// hook thread was on.
+	std::atomic<int> pressed{0}, unbalanced{0};
+	HotkeyEngine engine(
+		[&](ChordId, KeyEdge edge) {
+			if (edge == KeyEdge::Pressed)
+				pressed++;
+			else if (--pressed < 0)
+				unbalanced++;
+		},
+		KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}}));
+
+	std::atomic<bool> done{false};
+	std::thread hook([&]() {
+		while (!done.load()) {
+			engine.OnKeyEvent({KEY_CTRL, true});
+			engine.OnKeyEvent({KEY_A, true});
+			engine.OnKeyEvent({KEY_A, false});
+			engine.OnKeyEvent({KEY_CTRL, false});
+		}
+	});
+
+	for (uint32_t i = 0; i < 2000; i++) {
+		engine.SetHotkey(MakeChordId(KEY_A, MOD_CTRL), {KEY_A, MOD_CTRL, MOD_ALL});
+		engine.SetHotkey(MakeChordId((keycode_t)(KEY_FIRST + i % 100), 0), {(keycode_t)(KEY_FIRST + i % 100), 0, MOD_ALL});
+		if (i % 3 == 0)
+			engine.RemoveHotkey(MakeChordId(KEY_A, MOD_CTRL));
+	}
+	done = true;
+	hook.join();
+
+	CHECK_EQ(unbalanced.load(), 0);
+	CHECK(engine.RetiredTables() <= 2u);
+}
+
+int main()
+{
+	return RunNativeTests();
+}
@@ -0,0 +1,236 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+#include "native-test.h"
+#include "hotkey-engine.h"
+
+enum : keycode_t { KEY_SHIFT = 1, KEY_CTRL, KEY_A, KEY_B, KEY_K, KEY_S, KEY_FIRST };
+
+static const ChordId None = SequenceTrie::None;
+
+static SequenceTrie::Step Step(keycode_t key, uint8_t modifiers = 0, uint32_t timeoutMs = 1000)
+{
+	return {MakeChordId(key, modifiers), timeoutMs};
+}
+
+TEST_CASE(completes_and_restarts)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	CHECK(trie.Add(1, {Step(KEY_K, MOD_CTRL), Step(KEY_S, MOD_CTRL)}));
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, MOD_CTRL), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_S, MOD_CTRL), 10), 1u);
+
+	// A wrong second step abandons the sequence, unless it starts one.
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, MOD_CTRL), 20), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 30), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_S, MOD_CTRL), 40), None);
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, MOD_CTRL), 50), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, MOD_CTRL), 60), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_S, MOD_CTRL), 70), 1u);
+}
+
+TEST_CASE(per_step_timeouts)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	CHECK(trie.Add(1, {Step(KEY_A), Step(KEY_B, 0, 100), Step(KEY_K, 0, 500)}));
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 101), None); // too late
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 150), None);
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 1000), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 1100), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 1600), 1u);
+
+	// Timestamps wrap.
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0xFFFFFFF0u), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 0x20), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 0x30), 1u);
+}
+
+TEST_CASE(prefix_conflicts_rejected)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	CHECK(trie.Add(1, {Step(KEY_A), Step(KEY_B)}));
+	CHECK(!trie.Add(1, {Step(KEY_K)}));                          // id in use
+	CHECK(!trie.Add(2, {Step(KEY_A)}));                          // prefix of 1
+	CHECK(!trie.Add(2, {Step(KEY_A), Step(KEY_B)}));             // same as 1
+	CHECK(!trie.Add(2, {Step(KEY_A), Step(KEY_B), Step(KEY_K)})); // extends 1
+	CHECK(!trie.Add(2, {}));
+	CHECK(trie.Add(2, {Step(KEY_A), Step(KEY_K)}));
+	CHECK_EQ(trie.Size(), 2u);
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 0), 2u);
+}
+
+TEST_CASE(remove_frees_unshared_nodes)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	CHECK(trie.Add(1, {Step(KEY_A), Step(KEY_B)}));
+	CHECK(trie.Add(2, {Step(KEY_A), Step(KEY_K)}));
+	CHECK(trie.Remove(1));
+	CHECK(!trie.Remove(1));
+	cursor = {};
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 0), 2u);
+
+	// The removed path can be registered again, even as a prefix now.
+	CHECK(trie.Remove(2));
+	cursor = {};
+	CHECK(trie.Add(3, {Step(KEY_A)}));
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), 3u);
+}
+
+TEST_CASE(removed_timeouts_stop_counting)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	CHECK(trie.Add(1, {Step(KEY_A), Step(KEY_B, 0, 100), Step(KEY_K)}));
+	CHECK(trie.Add(2, {Step(KEY_A), Step(KEY_B, 0, 900), Step(KEY_S)}));
+
+	// The shared step waits for the longer timeout while both exist.
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 0), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 500), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 600), 1u);
+
+	CHECK(trie.Remove(2));
+	cursor = {};
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 1000), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 1500), None); // too late now
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 1600), None);
+
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_A, 0), 2000), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_B, 0), 2100), None);
+	CHECK_EQ(trie.Advance(cursor, MakeChordId(KEY_K, 0), 2200), 1u);
+}
+
+TEST_CASE(epoch_changes_on_remove)
+{
+	SequenceTrie trie;
+	uint64_t epoch = trie.Epoch();
+	CHECK(trie.Add(1, {Step(KEY_A), Step(KEY_B)}));
+	CHECK_EQ(trie.Epoch(), epoch);
+
+	SequenceTrie copy = trie;
+	CHECK_EQ(copy.Epoch(), epoch);
+	CHECK(copy.Remove(1));
+	CHECK(copy.Epoch() != epoch);
+	CHECK(SequenceTrie().Epoch() != epoch);
+}
+
+TEST_CASE(thousands_of_sequences)
+{
+	SequenceTrie trie;
+	SequenceTrie::Cursor cursor;
+	const uint32_t Count = 5000;
+	for (uint32_t i = 0; i < Count; i++) {
+		keycode_t first = (keycode_t)(KEY_FIRST + i % 50);
+		keycode_t second = (keycode_t)(KEY_FIRST + i / 50);
+		CHECK(trie.Add(MakeSequenceId(i), {Step(first, MOD_CTRL), Step(second, MOD_CTRL), Step(KEY_S, 0)}));
+	}
+
+	size_t completed = 0;
+	for (uint32_t i = 0; i < Count; i += 7) {
+		trie.Advance(cursor, MakeChordId((keycode_t)(KEY_FIRST + i % 50), MOD_CTRL), i);
+		trie.Advance(cursor, MakeChordId((keycode_t)(KEY_FIRST + i / 50), MOD_CTRL), i);
+		completed += trie.Advance(cursor, MakeChordId(KEY_S, 0), i) == MakeSequenceId(i);
+	}
+	CHECK_EQ(completed, (size_t)(Count + 6) / 7);
+
+	for (uint32_t i = 0; i < Count; i++)
+		CHECK(trie.Remove(MakeSequenceId(i)));
+	CHECK_EQ(trie.Size(), 0u);
+}
+
+TEST_CASE(engine_matches_sequences)
+{
+	uint32_t now = 0;
+	std::vector<ChordId> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back(edge == KeyEdge::Pressed ? id : None); },
+			    KeyState({{KEY_SHIFT, MOD_SHIFT, false}, {KEY_CTRL, MOD_CTRL, false}}));
+	engine.SetClock([&now]() { return now; });
+
+	ChordId id = MakeSequenceId(1);
+	CHECK(MakeSequenceId(1) != MakeChordId(0xFFFF, MOD_ALL));
+	CHECK(engine.SetSequence(id, {Step(KEY_K, MOD_CTRL), Step(KEY_S, MOD_CTRL, 500)}));
+
+	// Ctrl held through both strokes; auto-repeat doesn't count as a press.
+	for (KeyEvent event : std::vector<KeyEvent>{{KEY_CTRL, true}, {KEY_K, true}, {KEY_K, true}, {KEY_K, false}})
+		engine.OnKeyEvent(event);
+	now = 400;
+	engine.OnKeyEvent({KEY_S, true});
+	engine.OnKeyEvent({KEY_S, false});
+	engine.OnKeyEvent({KEY_CTRL, false});
+	CHECK_EQ(fired.size(), 1u);
+	CHECK(!fired.empty() && fired[0] == id);
+
+	// Too slow.
+	fired.clear();
+	for (KeyEvent event : std::vector<KeyEvent>{{KEY_CTRL, true}, {KEY_K, true}, {KEY_K, false}})
+		engine.OnKeyEvent(event);
+	now = 1000;
+	engine.OnKeyEvent({KEY_S, true});
+	CHECK(fired.empty());
+
+	engine.Clear();
+	CHECK(engine.SetSequence(id, {Step(KEY_A)}));
+}
+
+TEST_CASE(publishing_keeps_a_sequence_in_progress)
+{
+	uint32_t now = 0;
+	std::vector<ChordId> fired;
+	HotkeyEngine engine([&fired](ChordId id, KeyEdge edge) { fired.push_back(edge == KeyEdge::Pressed ? id : None); });
+	engine.SetClock([&now]() { return now; });
+
+	ChordId id = MakeSequenceId(1);
+	CHECK(engine.SetSequence(id, {Step(KEY_K), Step(KEY_S)}));
+	CHECK(engine.SetSequence(MakeSequenceId(2), {Step(KEY_B), Step(KEY_S)}));
+
+	// An unrelated hotkey registered between the strokes.
+	engine.OnKeyEvent({KEY_K, true});
+	engine.OnKeyEvent({KEY_K, false});
+	engine.SetHotkey(MakeChordId(KEY_A, 0), {KEY_A, 0, 0});
+	engine.OnKeyEvent({KEY_S, true});
+	CHECK_EQ(fired.size(), 1u);
+	CHECK(!fired.empty() && fired[0] == id);
+
+	// Removing a sequence restarts matching.
+	fired.clear();
+	engine.OnKeyEvent({KEY_S, false});
+	engine.OnKeyEvent({KEY_K, true});
+	engine.OnKeyEvent({KEY_K, false});
+	engine.RemoveSequence(MakeSequenceId(2));
+	engine.OnKeyEvent({KEY_S, true});
+	CHECK(fired.empty());
+}
+
+int main()
+{
+	return RunNativeTests();
+}
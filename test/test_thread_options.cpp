@@ -0,0 +1,97 @@
+/******************************************************************************
+    Copyright (C) 2016-2020 by Streamlabs (General Workings Inc)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+******************************************************************************/
+
+
+#include "native-test.h"
+#include "thread-options.h"
+
+#include <thread>
+
+// Each case runs on its own thread, the options stay with it.
+template<class F> static void OnThread(F f)
+{
+	std::thread thread(f);
+	thread.join();
+}
+
+TEST_CASE(normal_always_applies)
+{
+	OnThread([] {
+		ThreadOptions applied = ApplyThreadOptions(ThreadOptions());
+		CHECK(applied.policy == ThreadPolicy::Normal);
+		CHECK_EQ(applied.affinity, 0u);
+	});
+}
+
+TEST_CASE(refused_policies_fall_back)
+{
+	// Whether real time is allowed depends on who runs the test, but what took
+	// effect is never more than requested, and normal works afterwards.
+	OnThread([] {
+		ThreadOptions options;
+		options.policy = ThreadPolicy::Realtime;
+		options.priority = 5;
+		ThreadOptions applied = ApplyThreadOptions(options);
+		CHECK(applied.policy <= ThreadPolicy::Realtime);
+		if (applied.policy == ThreadPolicy::Realtime)
+			CHECK_EQ(applied.priority, 5);
+
+		options.policy = ThreadPolicy::High;
+		options.priority = 0;
+		applied = ApplyThreadOptions(options);
+		CHECK(applied.policy <= ThreadPolicy::High);
+		CHECK(applied.policy == ThreadPolicy::Normal || applied.priority != 0);
+
+		applied = ApplyThreadOptions(ThreadOptions());
+		CHECK(applied.policy == ThreadPolicy::Normal);
+	});
+}
+
+TEST_CASE(affinity)
+{
+	OnThread([] {
+		ThreadOptions options;
+		options.affinity = 1;
+		ThreadOptions applied = ApplyThreadOptions(options);
+#if defined(__APPLE__)
+		CHECK_EQ(applied.affinity, 0u);
+#else
+		CHECK_EQ(applied.affinity, 1u);
+#endif
+
+		// No CPU that exists.
+		options.affinity = 1ULL << 63;
+		if (std::thread::hardware_concurrency() < 64)
+			CHECK_EQ(ApplyThreadOptions(options).affinity, 0u);
+	});
+}
+
+TEST_CASE(policy_names)
+{
+	ThreadPolicy policy = ThreadPolicy::Normal;
+	CHECK(ParseThreadPolicy("realtime", policy));
+	CHECK(policy == ThreadPolicy::Realtime);
+	CHECK(!ParseThreadPolicy("idle", policy));
+	CHECK(policy == ThreadPolicy::Realtime);
+	CHECK_EQ(std::string(ThreadPolicyName(ThreadPolicy::High)), std::string("high"));
+}
+
+int main()
+{
+	return RunNativeTests();
+}